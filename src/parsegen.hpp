@@ -2,6 +2,8 @@
 
 #include "parsegen_error.hpp"
 #include "parsegen_parser.hpp"
+#include "parsegen_callback_parser.hpp"
+#include "parsegen_parser_snapshot.hpp"
 
 #include "parsegen_regex.hpp"
 #include "parsegen_math_lang.hpp"
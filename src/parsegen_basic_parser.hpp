@@ -0,0 +1,839 @@
+#ifndef PARSEGEN_BASIC_PARSER_HPP
+#define PARSEGEN_BASIC_PARSER_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <iosfwd>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "parsegen_error.hpp"
+#include "parsegen_memory_stream.hpp"
+#include "parsegen_parse_result.hpp"
+#include "parsegen_parser_tables.hpp"
+#include "parsegen_span.hpp"
+#include "parsegen_std_vector.hpp"
+
+namespace parsegen {
+
+using stream_position = std::istream::pos_type;
+
+/* the state of the lexer and of the LR(1) automaton,
+   which doesn't depend on the type of semantic values */
+class parser_base {
+ public:
+  parser_base() = delete;
+  parser_base(parser_base const&) = default;
+  parser_base(parser_tables_ptr tables_in);
+  /* returns the lexer and automaton to their initial state,
+     keeping the memory of the stacks and buffers for the next parse */
+  void reset();
+  /* renders the message for a failure reported by a try_parse_*
+     function, given the text that was parsed */
+  std::string describe(parse_failure const& failure_in,
+      std::string_view text, std::string_view name = "") const;
+  /* throws the exception parse_string would have thrown for the
+     failure, given the text that was parsed and, for failures of
+     kind action_error, the parse_result's action_message() */
+  [[noreturn]] void throw_failure(parse_failure const& failure_in,
+      std::string_view text, std::string_view name = "",
+      std::string const& action_message = "") const;
+  /* the syntax errors the last parse recovered from,
+     in the order they were found (see basic_parser) */
+  std::vector<parse_failure> const& get_diagnostics() const {
+    return diagnostics;
+  }
+
+  /* one entry of the LR stack: the automaton state, the symbol whose
+     shift or reduction entered it, and the offset (from the start of
+     the stream) where that symbol's text ends.
+     The bottom frame has no symbol and marks the start of the stream. */
+  struct stack_frame {
+    int state;
+    int symbol;
+    std::uint32_t end;
+  };
+  struct indent_stack_entry {
+    std::size_t start_length;
+    std::size_t end_length;
+  };
+  /* everything needed to resume the lexer and automaton from
+     a token boundary, other than the semantic values */
+  struct automaton_state {
+    std::uint32_t position;
+    /* how much of the input had been read to get this far */
+    std::uint32_t furthest_position;
+    std::vector<stack_frame> frames;
+    bool sensing_indent;
+    std::string indent_text;
+    std::vector<indent_stack_entry> indent_stack;
+    int recovery_countdown;
+    std::vector<parse_failure> diagnostics;
+  };
+
+ protected:
+  ~parser_base() = default;
+
+  parser_tables_ptr tables;
+  shift_reduce_tables const& syntax_tables;
+  finite_automaton const& lexical_tables;
+  grammar_ptr grammar;
+  /* positions are counted in characters from stream_start
+     rather than asked of the stream */
+  stream_position stream_start;
+  std::uint32_t position;
+  int lexer_state;
+  std::string lexer_text;
+  int lexer_token;
+  std::size_t last_lexer_accept;
+  std::uint32_t last_lexer_accept_position;
+  std::vector<stack_frame> frames;
+  std::string stream_name;
+  bool did_accept;
+  parse_failure failure;
+  std::vector<parse_failure> diagnostics;
+  /* how many more tokens must be shifted before a new syntax
+     error is reported rather than treated as part of the last one */
+  int recovery_countdown;
+  static constexpr int recovery_tokens = 3;
+
+ protected:  // variables for indentation-sensitive language parsing
+  bool sensing_indent;
+  std::string indent_text;
+  std::string lexer_indent;
+  // this is the stack that shows, for the current leading indentation
+  // characters, which subset of them came from each nested increase
+  // in indentation
+  std::vector<indent_stack_entry> indent_stack;
+
+ protected:  // variables for resuming a parse part way through
+  std::uint32_t furthest_position;
+
+ protected:  // helper methods
+  stream_position get_stream_position(std::uint32_t offset) const {
+    return stream_start + std::streamoff(offset);
+  }
+  void begin_parse(std::istream& stream, std::string_view stream_name_in);
+  void check_accepted(int value_stack_size);
+  void backtrack_to_last_accept(std::istream& stream);
+  void reset_lexer_state();
+  void save_state(automaton_state& out) const;
+  void restore_state(automaton_state const& in);
+  /* throws std::invalid_argument if the state could not have
+     been saved by a parser using these tables */
+  void check_state(automaton_state const& in, int nvalues) const;
+  void print_parser_stack(std::istream& stream, std::ostream& output);
+  parse_failure make_failure(decltype(parse_failure::kind) kind_value,
+      std::uint32_t first, std::uint32_t last) const;
+  /* records why the input was rejected; always returns false */
+  bool fail(decltype(parse_failure::kind) kind_value, std::uint32_t first, std::uint32_t last);
+  std::string describe(parse_failure const& failure_in, std::istream& stream,
+      stream_position start, std::string_view name) const;
+  /* throws the exception that describes the recorded failure */
+  [[noreturn]] void throw_failure(std::istream& stream);
+  [[noreturn]] void throw_described(parse_failure const& failure_in,
+      std::string const& message, std::string const& action_message) const;
+  [[noreturn]] void handle_reduce_exception(std::istream& stream, error& e, grammar::production const& prod);
+  [[noreturn]] void handle_shift_exception(std::istream& stream, error& e);
+};
+
+/* a parse stopped at a token boundary, from which
+   basic_parser::restore can carry it on */
+template <class Value>
+struct parser_snapshot {
+  parser_base::automaton_state state;
+  /* the value stack, one value per frame above the bottom one */
+  std::vector<Value> values;
+};
+
+/* The parsing driver, with the semantic actions supplied by Derived:
+
+     Value Derived::shift(int token, std::string& text);
+     Value Derived::reduce(int production, std::vector<Value>& rhs);
+
+   They are called directly rather than through virtual functions,
+   so small actions can be inlined into the driver.
+   Derived must make them accessible to basic_parser, e.g. by
+   declaring it a friend.
+
+   Derived may instead hide reduce_in_place(), which is given a view
+   of the right hand side values where they sit on top of the value
+   stack, so they need not be moved out into reduction_rhs first:
+
+     Value Derived::reduce_in_place(int production, span<Value> rhs);
+
+   Derived may also hide pass_through() to name productions whose
+   value is just one of their right hand side values (e.g. expr ::= term).
+   For those, reduce() is not called and the value is left in place
+   on the value stack instead of being moved through reduction_rhs.
+
+   Derived may also hide begin_input(), which is called before the
+   first action of every parse, including each input of parse_batch,
+   to discard state its actions keep from one input to the next.
+   If that state is read by later actions of the same input (e.g.
+   a table of the names defined so far) and checkpoints are taken,
+   Derived must also hide action_mark() and rewind_actions():
+
+     std::uint32_t Derived::action_mark() const;
+     void Derived::rewind_actions(std::uint32_t mark);
+
+   A checkpoint records action_mark(), and reparsing from it calls
+   rewind_actions() with that mark to take the state back to what
+   it was then, so the state must be kept in a form that can be
+   rewound, such as a log of the changes made to it.
+
+   If the language's productions use the "error" symbol, syntax
+   errors are recovered from the way yacc does it: the stack is
+   popped until a state that can shift "error", which is shifted
+   with a default-constructed Value, and then tokens are discarded
+   until one can be parsed. No new error is reported until three
+   tokens have been shifted. Each recovered error is recorded in
+   get_diagnostics() and the parse carries on; only an error that
+   no state on the stack can recover from, or a lexical error,
+   makes it fail. */
+template <class Derived, class Value>
+class basic_parser : public parser_base {
+ public:
+  using value_type = Value;
+  basic_parser(parser_tables_ptr tables_in) : parser_base(tables_in) {
+    reserve(value_stack, 64);
+  }
+  basic_parser(basic_parser const&) = default;
+  Value parse_stream(
+      std::istream& stream,
+      std::string_view stream_name_in = "");
+  Value parse_string(
+      std::string const& string,
+      std::string_view string_name = "");
+  Value parse_file(
+      std::filesystem::path const& file_path);
+  /* Like the parse_* functions, but an input that the language
+     rejects is reported through the result instead of by throwing,
+     and no message is rendered unless the caller asks for one with
+     describe(). Exceptions thrown by the semantic actions still
+     propagate. */
+  parse_result<Value> try_parse_stream(
+      std::istream& stream,
+      std::string_view stream_name_in = "");
+  parse_result<Value> try_parse_string(
+      std::string_view string,
+      std::string_view string_name = "");
+  /* Incremental reparsing for inputs that are edited and parsed
+     again, as in an editor. With a nonzero interval, each parse
+     records a checkpoint of the lexer, automaton, indentation and
+     value stacks at the first token boundary after every `bytes`
+     bytes of input. Value must be copyable to use this, and
+     copying the values on the stack should be cheap: values that
+     grow with the input (e.g. a list of all the items so far)
+     should share their parts, as a persistent list does, or each
+     checkpoint copies all of them and checkpointing costs time
+     and memory quadratic in the input. */
+  void set_checkpoint_interval(std::uint32_t bytes);
+  /* Parses text that is the same as the last input given to this
+     parser up to byte offset edit_first, resuming from the last
+     checkpoint that was taken before any text from edit_first on
+     was read, with the values that were on the stack then, so
+     the input before that checkpoint is neither parsed again nor
+     given to the semantic actions again. This is only equivalent
+     to parse_string if the actions build values without other
+     side effects, or rewind them (see action_mark above).
+     The input after the checkpoint is all lexed and parsed again,
+     up to the end: the parse does not stop where it gets back to
+     a state the previous parse was in at the same place after the
+     edit, to splice in the values of the rest of that parse,
+     since values made after the edit can depend on the edited
+     text in ways basic_parser can't see. The cost is therefore
+     proportional to the input from the checkpoint to the end,
+     not to the size of the edit. */
+  Value reparse_string(
+      std::string const& string,
+      std::uint32_t edit_first,
+      std::string_view string_name = "");
+  parse_result<Value> try_reparse_string(
+      std::string_view string,
+      std::uint32_t edit_first,
+      std::string_view string_name = "");
+  /* Checkpointing of long parses, so that one that is interrupted
+     can be carried on later, possibly by another process, instead
+     of starting over. With a handler set, the parse_* functions
+     call it with the snapshot() taken at the first token boundary
+     after every `bytes` bytes of input; it will usually save it
+     with write_snapshot (see parsegen_parser_snapshot.hpp).
+     Value must be copyable to use this. */
+  void set_snapshot_handler(std::uint32_t bytes,
+      std::function<void(parser_snapshot<Value> const&)> handler);
+  /* the state of the parse in progress, which is only complete at
+     a token boundary, i.e. when asked for by the snapshot handler */
+  parser_snapshot<Value> snapshot() const;
+  /* Loads a snapshot taken by a parser with the same tables,
+     for the next resume_* call to carry on from. */
+  void restore(parser_snapshot<Value> from);
+  /* Carries on the restored parse, reading the rest of the input
+     from stream, which must be positioned at the start of the same
+     input the snapshot was taken from. The snapshot handler is
+     called as it is by parse_stream. */
+  Value resume_stream(
+      std::istream& stream,
+      std::string_view stream_name_in = "");
+  Value resume_file(
+      std::filesystem::path const& file_path);
+  /* Parses each input in turn, writing one parse_result<Value> per
+     input to out, in order. Rejected inputs, and exceptions thrown
+     by the semantic actions, are reported in their results rather
+     than thrown, and one stream and this parser's retained buffers
+     are reused for all of them. */
+  template <class OutputIterator>
+  OutputIterator parse_batch(
+      span<std::string_view const> inputs, OutputIterator out);
+  /* Discards the state and values of the previous parse,
+     keeping the capacity of the stacks and of the lexer and
+     indentation buffers, so a parser that is reused for many
+     small inputs stops allocating once it has seen the largest.
+     The parse_* functions call this themselves. */
+  void reset();
+
+ protected:
+  ~basic_parser() = default;
+  std::vector<Value> value_stack;
+  std::vector<Value> reduction_rhs;
+  /* the index of the right hand side symbol whose value the given
+     production passes through, or -1 to call reduce() */
+  int pass_through(int) const { return -1; }
+  void begin_input() {}
+  std::uint32_t action_mark() const { return 0; }
+  void rewind_actions(std::uint32_t) {}
+  Value reduce_in_place(int production, span<Value> rhs) {
+    reduction_rhs.clear();
+    for (auto& value : rhs) reduction_rhs.emplace_back(std::move(value));
+    return derived().reduce(production, reduction_rhs);
+  }
+
+ private:
+  Derived& derived() { return static_cast<Derived&>(*this); }
+  struct checkpoint {
+    automaton_state state;
+    std::vector<Value> values;
+    /* what derived().action_mark() was when it was taken */
+    std::uint32_t action_mark;
+  };
+  std::vector<checkpoint> checkpoints;
+  std::uint32_t checkpoint_interval = 0;
+  std::uint32_t next_checkpoint_position = no_checkpoint;
+  std::function<void(parser_snapshot<Value> const&)> snapshot_handler;
+  std::uint32_t snapshot_interval = 0;
+  std::uint32_t next_snapshot_position = no_checkpoint;
+  bool is_restored = false;
+  static constexpr std::uint32_t no_checkpoint = ~std::uint32_t(0);
+  /* the first position at least interval past this one,
+     or no_checkpoint if there is none */
+  std::uint32_t after_interval(std::uint32_t interval) const {
+    auto const next = position + interval;
+    return (interval == 0 || next < position) ? no_checkpoint : next;
+  }
+  void save_checkpoint();
+  void call_snapshot_handler();
+  void reduce_values(int production);
+  /* these return false once the input has been rejected */
+  bool run(std::istream& stream, std::string_view stream_name_in);
+  bool rerun(std::istream& stream, std::uint32_t edit_first,
+      std::string_view stream_name_in);
+  bool run_to_end(std::istream& stream);
+  bool shift_error_terminal();
+  bool at_token(std::istream& stream);
+  bool at_token_indent(std::istream& stream);
+  bool at_lexer_end(std::istream& stream);
+};
+
+template <class Derived, class Value>
+bool basic_parser<Derived, Value>::at_token(std::istream& stream) {
+  bool done = false;
+  /* this can loop arbitrarily as reductions are made,
+     because they don't consume the token */
+  while (!done) {
+    auto parser_action =
+        get_action(syntax_tables, frames.back().state, lexer_token);
+    if (parser_action.kind == action::kind::none) {
+      if (get_error_terminal(*grammar) == -1) {
+        return fail(parse_failure::kind::unacceptable_token,
+            frames.back().end, last_lexer_accept_position);
+      }
+      if (recovery_countdown == recovery_tokens) {
+        /* nothing has been shifted since "error", so
+           discard the lookahead and wait for the next one */
+        if (lexer_token == get_end_terminal(*grammar)) {
+          return fail(parse_failure::kind::unacceptable_token,
+              frames.back().end, last_lexer_accept_position);
+        }
+        return true;
+      }
+      if (!shift_error_terminal()) return false;
+      /* retry the lookahead after "error" */
+      continue;
+    } else if (parser_action.kind == action::kind::shift) {
+      Value shift_result;
+      try {
+        shift_result = derived().shift(lexer_token, lexer_text);
+      } catch (error& e) {
+        handle_shift_exception(stream, e);
+      }
+      value_stack.emplace_back(std::move(shift_result));
+      frames.push_back(
+          {parser_action.next_state, lexer_token, last_lexer_accept_position});
+      if (recovery_countdown > 0) --recovery_countdown;
+      done = true;
+    } else if (parser_action.kind == action::kind::reduce) {
+      if (parser_action.production == get_accept_production(*grammar)) {
+        did_accept = true;
+        return true;
+      }
+      auto& prod = at(grammar->productions, parser_action.production);
+      auto const nrhs = isize(prod.rhs);
+      try {
+        reduce_values(parser_action.production);
+      } catch (error& e) {
+        handle_reduce_exception(stream, e, prod);
+      }
+      /* the new frame replaces the right hand side frames
+         and ends where the last of them ended */
+      auto const first_frame = isize(frames) - nrhs;
+      auto const end = frames.back().end;
+      auto const next_state = get_goto(
+          syntax_tables, at(frames, first_frame - 1).state, prod.lhs);
+      resize(frames, first_frame);
+      frames.push_back({next_state, prod.lhs, end});
+    } else if (parser_action.kind == action::kind::skip) {
+      frames.back().end = last_lexer_accept_position;
+      done = true;
+    } else {
+      throw std::logic_error(
+          "serious bug in parsegen::parser: action::kind enum value out of range\n");
+    }
+  }
+  return true;
+}
+
+template <class Derived, class Value>
+bool basic_parser<Derived, Value>::shift_error_terminal() {
+  auto const error_terminal = get_error_terminal(*grammar);
+  auto const error_here = make_failure(parse_failure::kind::unacceptable_token,
+      frames.back().end, last_lexer_accept_position);
+  auto frame = isize(frames) - 1;
+  while (get_action(syntax_tables, at(frames, frame).state, error_terminal)
+      .kind != action::kind::shift) {
+    if (frame == 0) {
+      failure = error_here;
+      return false;
+    }
+    --frame;
+  }
+  if (recovery_countdown == 0) diagnostics.push_back(error_here);
+  auto const end = frames.back().end;
+  resize(frames, frame + 1);
+  resize(value_stack, frame);
+  auto const& error_action =
+      get_action(syntax_tables, frames.back().state, error_terminal);
+  frames.push_back({error_action.next_state, error_terminal, end});
+  value_stack.emplace_back();
+  recovery_countdown = recovery_tokens;
+  return true;
+}
+
+template <class Derived, class Value>
+bool basic_parser<Derived, Value>::at_token_indent(std::istream& stream) {
+  if (!sensing_indent || lexer_token != tables->indent_info.newline_token) {
+    return at_token(stream);
+  }
+  auto last_newline_pos = lexer_text.find_last_of("\n");
+  if (last_newline_pos == std::string::npos) {
+    throw error("", "", "INDENT token did not contain a newline");
+  }
+  lexer_indent.assign(lexer_text, last_newline_pos + 1, std::string::npos);
+  // the at_token call is allowed to do anything to lexer_text
+  if (!at_token(stream)) return false;
+  lexer_text.clear();
+  std::size_t minlen = std::min(lexer_indent.length(), indent_text.length());
+  if (lexer_indent.length() > indent_text.length()) {
+    if (0 != lexer_indent.compare(0, indent_text.length(), indent_text)) {
+      return fail(parse_failure::kind::indent_mismatch,
+          last_lexer_accept_position, last_lexer_accept_position);
+    }
+    indent_stack.push_back({indent_text.length(), lexer_indent.length()});
+    indent_text.assign(lexer_indent);
+    lexer_token = tables->indent_info.indent_token;
+    if (!at_token(stream)) return false;
+  } else if (lexer_indent.length() < indent_text.length()) {
+    if (0 != indent_text.compare(0, lexer_indent.length(), lexer_indent)) {
+      return fail(parse_failure::kind::indent_mismatch,
+          last_lexer_accept_position, last_lexer_accept_position);
+    }
+    while (!indent_stack.empty()) {
+      auto top = indent_stack.back();
+      if (top.end_length <= minlen) break;
+      indent_stack.pop_back();
+      lexer_token = tables->indent_info.dedent_token;
+      if (!at_token(stream)) return false;
+    }
+    indent_text.assign(lexer_indent);
+  } else {
+    if (0 != lexer_indent.compare(indent_text)) {
+      return fail(parse_failure::kind::indent_mismatch,
+          last_lexer_accept_position, last_lexer_accept_position);
+    }
+  }
+  return true;
+}
+
+template <class Derived, class Value>
+bool basic_parser<Derived, Value>::at_lexer_end(std::istream& stream) {
+  if (lexer_token == -1) {
+    return fail(parse_failure::kind::tokenization_failure,
+        last_lexer_accept_position, position);
+  }
+  furthest_position = std::max(furthest_position, position);
+  backtrack_to_last_accept(stream);
+  if (!at_token_indent(stream)) return false;
+  reset_lexer_state();
+  return true;
+}
+
+template <class Derived, class Value>
+bool basic_parser<Derived, Value>::run(
+    std::istream& stream, std::string_view stream_name_in) {
+  reset();
+  begin_parse(stream, stream_name_in);
+  derived().begin_input();
+  next_checkpoint_position = checkpoint_interval ? 0 : no_checkpoint;
+  next_snapshot_position = after_interval(snapshot_interval);
+  return run_to_end(stream);
+}
+
+template <class Derived, class Value>
+bool basic_parser<Derived, Value>::rerun(std::istream& stream,
+    std::uint32_t edit_first, std::string_view stream_name_in) {
+  auto it = checkpoints.rbegin();
+  while (it != checkpoints.rend() &&
+         it->state.furthest_position > edit_first) {
+    ++it;
+  }
+  if (it == checkpoints.rend()) return run(stream, stream_name_in);
+  /* the checkpoints after this one saw the edited text */
+  checkpoints.erase(it.base(), checkpoints.end());
+  auto const& resume_point = checkpoints.back();
+  begin_parse(stream, stream_name_in);
+  restore_state(resume_point.state);
+  if constexpr (std::is_copy_constructible<Value>::value) {
+    value_stack = resume_point.values;
+  }
+  reduction_rhs.clear();
+  derived().rewind_actions(resume_point.action_mark);
+  stream.seekg(get_stream_position(position));
+  next_checkpoint_position = after_interval(checkpoint_interval);
+  next_snapshot_position = after_interval(snapshot_interval);
+  return run_to_end(stream);
+}
+
+template <class Derived, class Value>
+void basic_parser<Derived, Value>::save_checkpoint() {
+  if constexpr (std::is_copy_constructible<Value>::value) {
+    checkpoints.emplace_back();
+    save_state(checkpoints.back().state);
+    checkpoints.back().values = value_stack;
+    checkpoints.back().action_mark = derived().action_mark();
+    next_checkpoint_position = after_interval(checkpoint_interval);
+  }
+}
+
+template <class Derived, class Value>
+void basic_parser<Derived, Value>::reduce_values(int production) {
+  auto const nrhs = isize(at(grammar->productions, production).rhs);
+  auto const first_value = isize(value_stack) - nrhs;
+  auto const passed = derived().pass_through(production);
+  if (passed >= 0) {
+    if (passed != 0) {
+      at(value_stack, first_value) =
+          std::move(at(value_stack, first_value + passed));
+    }
+    resize(value_stack, first_value + 1);
+    return;
+  }
+  auto reduce_result = derived().reduce_in_place(production,
+      span<Value>(value_stack.data() + first_value, nrhs));
+  if (nrhs == 0) {
+    value_stack.emplace_back(std::move(reduce_result));
+  } else {
+    at(value_stack, first_value) = std::move(reduce_result);
+    resize(value_stack, first_value + 1);
+  }
+}
+
+template <class Derived, class Value>
+void basic_parser<Derived, Value>::call_snapshot_handler() {
+  if constexpr (std::is_copy_constructible<Value>::value) {
+    snapshot_handler(snapshot());
+    next_snapshot_position = after_interval(snapshot_interval);
+  }
+}
+
+template <class Derived, class Value>
+bool basic_parser<Derived, Value>::run_to_end(std::istream& stream) {
+  char c;
+  while (stream.get(c)) {
+    if (!is_symbol(c)) {
+      return fail(parse_failure::kind::bad_character, position, position + 1);
+    }
+    if (++position == 0) {
+      return fail(parse_failure::kind::stream_too_long, 0, 0);
+    }
+    lexer_text.push_back(c);
+    auto lexer_symbol = get_symbol(c);
+    lexer_state = step(lexical_tables, lexer_state, lexer_symbol);
+    if (lexer_state == -1) {
+      if (!at_lexer_end(stream)) return false;
+      if (position >= next_checkpoint_position) save_checkpoint();
+      if (position >= next_snapshot_position) call_snapshot_handler();
+    } else {
+      auto token = accepts(lexical_tables, lexer_state);
+      if (token != -1) {
+        lexer_token = token;
+        last_lexer_accept = lexer_text.size();
+        last_lexer_accept_position = position;
+      }
+    }
+  }
+  if (last_lexer_accept < lexer_text.size()) {
+    return fail(parse_failure::kind::tokenization_failure,
+        last_lexer_accept_position, position);
+  }
+  if (!at_lexer_end(stream)) return false;
+  lexer_token = get_end_terminal(*grammar);
+  if (!at_token(stream)) return false;
+  check_accepted(isize(value_stack));
+  return true;
+}
+
+template <class Derived, class Value>
+Value basic_parser<Derived, Value>::parse_stream(
+    std::istream& stream, std::string_view stream_name_in) {
+  if (!run(stream, stream_name_in)) throw_failure(stream);
+  return std::move(value_stack.back());
+}
+
+template <class Derived, class Value>
+parse_result<Value> basic_parser<Derived, Value>::try_parse_stream(
+    std::istream& stream, std::string_view stream_name_in) {
+  if (!run(stream, stream_name_in)) {
+    return parse_result<Value>::from_failure(failure);
+  }
+  return parse_result<Value>::from_value(std::move(value_stack.back()));
+}
+
+template <class Derived, class Value>
+parse_result<Value> basic_parser<Derived, Value>::try_parse_string(
+    std::string_view string, std::string_view string_name) {
+  memory_istream stream(string);
+  return try_parse_stream(stream, string_name);
+}
+
+template <class Derived, class Value>
+void basic_parser<Derived, Value>::reset() {
+  parser_base::reset();
+  value_stack.clear();
+  reduction_rhs.clear();
+  checkpoints.clear();
+  is_restored = false;
+}
+
+template <class Derived, class Value>
+void basic_parser<Derived, Value>::set_snapshot_handler(std::uint32_t bytes,
+    std::function<void(parser_snapshot<Value> const&)> handler) {
+  static_assert(std::is_copy_constructible<Value>::value,
+      "snapshots need to copy the values on the stack");
+  snapshot_interval = handler ? bytes : 0;
+  snapshot_handler = std::move(handler);
+}
+
+template <class Derived, class Value>
+parser_snapshot<Value> basic_parser<Derived, Value>::snapshot() const {
+  parser_snapshot<Value> out;
+  save_state(out.state);
+  out.values = value_stack;
+  return out;
+}
+
+template <class Derived, class Value>
+void basic_parser<Derived, Value>::restore(parser_snapshot<Value> from) {
+  check_state(from.state, isize(from.values));
+  reset();
+  restore_state(from.state);
+  value_stack = std::move(from.values);
+  is_restored = true;
+}
+
+template <class Derived, class Value>
+Value basic_parser<Derived, Value>::resume_stream(
+    std::istream& stream, std::string_view stream_name_in) {
+  if (!is_restored) {
+    throw std::logic_error(
+        "parsegen::parser::resume_stream called without restore()");
+  }
+  is_restored = false;
+  begin_parse(stream, stream_name_in);
+  stream.seekg(get_stream_position(position));
+  if (!stream) {
+    throw error("", "", "Could not seek " + std::string(stream_name_in) +
+        " to where the snapshot was taken");
+  }
+  next_checkpoint_position = after_interval(checkpoint_interval);
+  next_snapshot_position = after_interval(snapshot_interval);
+  if (!run_to_end(stream)) throw_failure(stream);
+  return std::move(value_stack.back());
+}
+
+template <class Derived, class Value>
+Value basic_parser<Derived, Value>::resume_file(
+    std::filesystem::path const& file_path) {
+  std::ifstream stream(file_path);
+  if (!stream.is_open()) {
+    throw error("", "", "Could not open file " + file_path.string());
+  }
+  return resume_stream(stream, file_path.string());
+}
+
+template <class Derived, class Value>
+void basic_parser<Derived, Value>::set_checkpoint_interval(
+    std::uint32_t bytes) {
+  static_assert(std::is_copy_constructible<Value>::value,
+      "checkpoints need to copy the values on the stack");
+  checkpoint_interval = bytes;
+}
+
+template <class Derived, class Value>
+Value basic_parser<Derived, Value>::reparse_string(
+    std::string const& string,
+    std::uint32_t edit_first,
+    std::string_view string_name) {
+  memory_istream stream(string);
+  edit_first = std::uint32_t(std::min(std::size_t(edit_first), string.size()));
+  if (!rerun(stream, edit_first, string_name)) throw_failure(stream);
+  return std::move(value_stack.back());
+}
+
+template <class Derived, class Value>
+parse_result<Value> basic_parser<Derived, Value>::try_reparse_string(
+    std::string_view string,
+    std::uint32_t edit_first,
+    std::string_view string_name) {
+  memory_istream stream(string);
+  edit_first = std::uint32_t(std::min(std::size_t(edit_first), string.size()));
+  if (!rerun(stream, edit_first, string_name)) {
+    return parse_result<Value>::from_failure(failure);
+  }
+  return parse_result<Value>::from_value(std::move(value_stack.back()));
+}
+
+template <class Derived, class Value>
+Value basic_parser<Derived, Value>::parse_string(
+    std::string const& string, std::string_view string_name) {
+  memory_istream stream(string);
+  return parse_stream(stream, string_name);
+}
+
+template <class Derived, class Value>
+Value basic_parser<Derived, Value>::parse_file(
+    std::filesystem::path const& file_path) {
+  std::ifstream stream(file_path);
+  if (!stream.is_open()) {
+    throw error("", "", "Could not open file " + file_path.string());
+  }
+  return parse_stream(stream, file_path.string());
+}
+
+template <class Derived, class Value>
+template <class OutputIterator>
+OutputIterator basic_parser<Derived, Value>::parse_batch(
+    span<std::string_view const> inputs, OutputIterator out) {
+  memory_istream stream{std::string_view()};
+  for (auto const input : inputs) {
+    stream.reset(input);
+    try {
+      *out = try_parse_stream(stream);
+    } catch (error const& e) {
+      /* handle_shift_exception or handle_reduce_exception recorded
+         where the action failed, which describe() renders */
+      if (failure.kind != parse_failure::kind::action_error) {
+        failure = make_failure(parse_failure::kind::action_error,
+            frames.back().end, last_lexer_accept_position);
+      }
+      *out = parse_result<Value>::from_failure(failure,
+          e.before_message() + e.after_message());
+    } catch (std::exception const& e) {
+      auto const action_failure = make_failure(parse_failure::kind::action_error,
+          frames.back().end, last_lexer_accept_position);
+      *out = parse_result<Value>::from_failure(action_failure, e.what());
+    }
+    ++out;
+  }
+  return out;
+}
+
+/* Like basic_parser::parse_batch, but the inputs are split into
+   contiguous chunks that are parsed concurrently, each by its own
+   copy of prototype made with Parser's copy constructor.
+   The results are written to out in input order once all the
+   chunks are done. */
+template <class Parser, class OutputIterator>
+OutputIterator parse_batch(
+    Parser const& prototype,
+    span<std::string_view const> inputs,
+    OutputIterator out,
+    int nthreads) {
+  using result_type = parse_result<typename Parser::value_type>;
+  nthreads = std::max(1, std::min(nthreads, isize(inputs)));
+  if (nthreads == 1) {
+    Parser worker(prototype);
+    return worker.parse_batch(inputs, out);
+  }
+  auto chunk_results = make_vector<std::vector<result_type>>(nthreads);
+  auto chunk_errors = make_vector<std::exception_ptr>(nthreads);
+  std::vector<std::thread> threads;
+  reserve(threads, nthreads);
+  for (int t = 0; t < nthreads; ++t) {
+    auto const first = int(std::int64_t(isize(inputs)) * t / nthreads);
+    auto const last = int(std::int64_t(isize(inputs)) * (t + 1) / nthreads);
+    threads.emplace_back([&, t, first, last] {
+      try {
+        Parser worker(prototype);
+        auto& results = at(chunk_results, t);
+        reserve(results, last - first);
+        worker.parse_batch(inputs.subspan(first, last - first),
+            std::back_inserter(results));
+      } catch (...) {
+        at(chunk_errors, t) = std::current_exception();
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  for (auto& chunk_error : chunk_errors) {
+    if (chunk_error) std::rethrow_exception(chunk_error);
+  }
+  for (auto& results : chunk_results) {
+    for (auto& result : results) {
+      *out = std::move(result);
+      ++out;
+    }
+  }
+  return out;
+}
+
+}  // namespace parsegen
+
+#endif
@@ -4,9 +4,10 @@
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
-#include <map>
 #include <queue>
 
+#include "parsegen_build_profile.hpp"
+#include "parsegen_build_result.hpp"
 #include "parsegen_parser_graph.hpp"
 #include "parsegen_set.hpp"
 #include "parsegen_std_stack.hpp"
@@ -40,125 +41,175 @@ static configurations make_configs(grammar const& g) {
 
 static parser_graph get_left_hand_sides_to_start_configs(
     configurations const& cs, grammar const& grammar) {
-  auto lhs2sc = make_graph_with_nnodes(grammar.nsymbols);
+  edge_list lhs2sc;
   for (int c_i = 0; c_i < isize(cs); ++c_i) {
     auto& c = at(cs, c_i);
     if (c.dot > 0) continue;
     auto p_i = c.production;
     auto& p = at(grammar.productions, p_i);
-    add_edge(lhs2sc, p.lhs, c_i);
+    lhs2sc.push_back({p.lhs, c_i});
   }
-  return lhs2sc;
+  return make_graph_from_edges(grammar.nsymbols, lhs2sc);
 }
 
-struct state_compare {
-  using value_type = state_in_progress const*;
-  bool operator()(value_type const& a, value_type const& b) const {
-    return a->configs < b->configs;
+int get_nstates(parser_in_progress const& pip) {
+  return isize(pip.state_config_offsets) - 1;
+}
+
+int get_nstate_configs(parser_in_progress const& pip) {
+  return isize(pip.state_configs);
+}
+
+span<int const> get_configs(parser_in_progress const& pip, int state) {
+  auto first = at(pip.state_config_offsets, state);
+  auto last = at(pip.state_config_offsets, state + 1);
+  return span<int const>(pip.state_configs.data() + first, last - first);
+}
+
+span<action_in_progress const> get_actions(
+    parser_in_progress const& pip, int state) {
+  auto first = at(pip.action_offsets, state);
+  auto last = at(pip.action_offsets, state + 1);
+  return span<action_in_progress const>(pip.actions.data() + first, last - first);
+}
+
+span<int const> get_context(
+    parser_in_progress const& pip, action_in_progress const& action) {
+  if (action.action.kind == action::kind::shift) {
+    return span<int const>(&action.symbol, 1);
   }
-};
+  auto first = at(pip.lookahead_offsets, action.state_config);
+  auto last = at(pip.lookahead_offsets, action.state_config + 1);
+  return span<int const>(pip.lookaheads.data() + first, last - first);
+}
 
-using state_ptr_to_state_index_map = std::map<state_in_progress const*, int, state_compare>;
+static int get_state_config(parser_in_progress const& pip, int state, int cis) {
+  return at(pip.state_config_offsets, state) + cis;
+}
 
-static void close(state_in_progress& state, configurations const& cs,
-    grammar const& grammar, parser_graph const& lhs2sc) {
-  std::queue<int> config_q;
-  std::set<int> config_set;
-  for (auto config_i : state.configs) {
-    config_q.push(config_i);
-    assert(!config_set.count(config_i));
-    config_set.insert(config_i);
+static configuration const& get_config_of(
+    parser_in_progress const& pip, int sc) {
+  return at(pip.configs, at(pip.state_configs, sc));
+}
+
+/* the configurations of the state being built live at the end of
+   the shared array, from `first` on. close them in place and sort. */
+static void close(std::vector<int>& state_configs, int first,
+    configurations const& cs, grammar const& grammar,
+    parser_graph const& lhs2sc, std::vector<bool>& in_closure) {
+  for (int i = first; i < isize(state_configs); ++i) {
+    auto config_i = at(state_configs, i);
+    assert(!at(in_closure, config_i));
+    at(in_closure, config_i) = true;
   }
-  while (!config_q.empty()) {
-    auto config_i = config_q.front();
-    config_q.pop();
-    auto& config = at(cs, config_i);
+  /* the tail of the array doubles as the work queue */
+  for (int i = first; i < isize(state_configs); ++i) {
+    auto& config = at(cs, at(state_configs, i));
     auto prod_i = config.production;
     auto& prod = at(grammar.productions, prod_i);
     if (config.dot == isize(prod.rhs)) continue;
     auto symbol_after_dot = at(prod.rhs, config.dot);
     if (is_terminal(grammar, symbol_after_dot)) continue;
     for (auto sc : get_edges(lhs2sc, symbol_after_dot)) {
-      if (!config_set.count(sc)) {
-        config_set.insert(sc);
-        config_q.push(sc);
+      if (!at(in_closure, sc)) {
+        at(in_closure, sc) = true;
+        state_configs.push_back(sc);
       }
     }
   }
-  state.configs.assign(config_set.begin(), config_set.end());
+  for (int i = first; i < isize(state_configs); ++i) {
+    at(in_closure, at(state_configs, i)) = false;
+  }
+  std::sort(state_configs.begin() + first, state_configs.end());
 }
 
-static void emplace_back(state_in_progress_vector& sips, state_in_progress& sip) {
-  sips.push_back(
-      std::unique_ptr<state_in_progress>(new state_in_progress(std::move(sip))));
-}
+/* orders states by their (sorted) configurations. the key NEW_STATE
+   stands for the state being built at the end of the array. */
+enum { NEW_STATE = -1 };
 
-static void add_reduction_actions(
-    state_in_progress_vector& states, configurations const& cs, grammar const& grammar) {
-  for (auto& state_uptr : states) {
-    auto& state = *state_uptr;
-    for (auto config_i : state.configs) {
-      auto& config = at(cs, config_i);
-      auto prod_i = config.production;
-      auto& prod = at(grammar.productions, prod_i);
-      if (config.dot != isize(prod.rhs)) continue;
-      action_in_progress reduction;
-      reduction.action.kind = action::kind::reduce;
-      reduction.action.production = config.production;
-      state.actions.push_back(reduction);
-    }
+struct state_compare {
+  std::vector<int> const* configs;
+  std::vector<int> const* offsets;
+  span<int const> get(int state) const {
+    auto first = configs->data() + at(*offsets, state == NEW_STATE
+        ? isize(*offsets) - 1 : state);
+    auto last = state == NEW_STATE
+        ? configs->data() + configs->size()
+        : configs->data() + at(*offsets, state + 1);
+    return span<int const>(first, last);
   }
-}
+  bool operator()(int a, int b) const {
+    auto sa = get(a);
+    auto sb = get(b);
+    return std::lexicographical_compare(
+        sa.begin(), sa.end(), sb.begin(), sb.end());
+  }
+};
 
-static void set_lr0_contexts(state_in_progress_vector& states, grammar const& grammar) {
-  for (auto& state_uptr : states) {
-    auto& state = *state_uptr;
-    for (auto& action : state.actions) {
-      if (action.action.kind != action::kind::reduce) continue;
-      if (action.action.production == get_accept_production(grammar)) {
-        action.context.insert(get_end_terminal(grammar));
+static void set_lr0_lookaheads(parser_in_progress& pip) {
+  auto& grammar = *pip.grammar;
+  pip.lookahead_offsets.assign(1, 0);
+  pip.lookaheads.clear();
+  for (int sc = 0; sc < get_nstate_configs(pip); ++sc) {
+    auto& config = get_config_of(pip, sc);
+    auto& prod = at(grammar.productions, config.production);
+    if (config.dot == isize(prod.rhs)) {
+      if (config.production == get_accept_production(grammar)) {
+        pip.lookaheads.push_back(get_end_terminal(grammar));
       } else {
         for (int terminal = 0; terminal < grammar.nterminals; ++terminal) {
-          action.context.insert(terminal);
+          pip.lookaheads.push_back(terminal);
         }
       }
     }
+    pip.lookahead_offsets.push_back(isize(pip.lookaheads));
   }
 }
 
-static state_in_progress_vector build_lr0_parser(
-    configurations const& cs, grammar const& grammar, parser_graph const& lhs2sc) {
-  state_in_progress_vector states;
-  state_ptr_to_state_index_map state_ptrs2idxs;
-  std::queue<int> state_q;
+static void build_lr0_parser(parser_in_progress& pip, parser_graph const& lhs2sc) {
+  auto& cs = pip.configs;
+  auto& grammar = *pip.grammar;
+  auto& offsets = pip.state_config_offsets;
+  auto& state_configs = pip.state_configs;
+  offsets.assign(1, 0);
+  state_configs.clear();
+  auto in_closure = make_vector<bool>(isize(cs), false);
+  std::set<int, state_compare> known_states(
+      state_compare{&state_configs, &offsets});
   { /* start state */
-    state_in_progress start_state;
     auto accept_nt = get_accept_nonterminal(grammar);
     /* there should only be one start configuration for the accept symbol */
     auto start_accept_config = get_edges(lhs2sc, accept_nt).front();
-    start_state.configs.push_back(start_accept_config);
-    close(start_state, cs, grammar, lhs2sc);
-    auto start_state_i = isize(states);
-    state_q.push(start_state_i);
-    emplace_back(states, start_state);
-    state_ptrs2idxs[states.back().get()] = start_state_i;
+    state_configs.push_back(start_accept_config);
+    close(state_configs, 0, cs, grammar, lhs2sc, in_closure);
+    offsets.push_back(isize(state_configs));
+    known_states.insert(0);
   }
-  while (!state_q.empty()) {
-    auto state_i = state_q.front();
-    state_q.pop();
-    auto& state = *at(states, state_i);
-    std::set<int> transition_symbols;
-    for (auto config_i : state.configs) {
-      auto& config = at(cs, config_i);
+  std::vector<int> shift_offsets(1, 0);
+  std::vector<action_in_progress> shifts;
+  std::vector<int> transition_symbols;
+  /* states are numbered in the order they are discovered,
+     so visiting them by index is a breadth-first traversal */
+  for (int state_i = 0; state_i < get_nstates(pip); ++state_i) {
+    auto first = at(offsets, state_i);
+    auto last = at(offsets, state_i + 1);
+    transition_symbols.clear();
+    for (int i = first; i < last; ++i) {
+      auto& config = at(cs, at(state_configs, i));
       auto prod_i = config.production;
       auto& prod = at(grammar.productions, prod_i);
       if (config.dot == isize(prod.rhs)) continue;
       auto symbol_after_dot = at(prod.rhs, config.dot);
-      transition_symbols.insert(symbol_after_dot);
+      transition_symbols.push_back(symbol_after_dot);
     }
+    std::sort(transition_symbols.begin(), transition_symbols.end());
+    transition_symbols.erase(
+        std::unique(transition_symbols.begin(), transition_symbols.end()),
+        transition_symbols.end());
     for (auto transition_symbol : transition_symbols) {
-      state_in_progress next_state;
-      for (auto config_i : state.configs) {
+      auto next_first = isize(state_configs);
+      for (int i = first; i < last; ++i) {
+        auto config_i = at(state_configs, i);
         auto& config = at(cs, config_i);
         auto prod_i = config.production;
         auto& prod = at(grammar.productions, prod_i);
@@ -167,39 +218,62 @@ static state_in_progress_vector build_lr0_parser(
         if (symbol_after_dot != transition_symbol) continue;
         /* transition successor should just be the next index */
         auto next_config_i = config_i + 1;
-        next_state.configs.push_back(next_config_i);
+        state_configs.push_back(next_config_i);
       }
-      close(next_state, cs, grammar, lhs2sc);
-      auto it = state_ptrs2idxs.find(&next_state);
+      close(state_configs, next_first, cs, grammar, lhs2sc, in_closure);
+      auto it = known_states.find(NEW_STATE);
       int next_state_i;
-      if (it == state_ptrs2idxs.end()) {
-        next_state_i = isize(states);
-        state_q.push(next_state_i);
-        emplace_back(states, next_state);
-        state_ptrs2idxs[states.back().get()] = next_state_i;
+      if (it == known_states.end()) {
+        next_state_i = get_nstates(pip);
+        offsets.push_back(isize(state_configs));
+        known_states.insert(next_state_i);
       } else {
-        next_state_i = it->second;
+        next_state_i = *it;
+        resize(state_configs, next_first);
       }
       action_in_progress transition;
       transition.action.kind = action::kind::shift;
       transition.action.next_state = next_state_i;
-      transition.context.insert(transition_symbol);
-      state.actions.emplace_back(std::move(transition));
+      transition.symbol = transition_symbol;
+      transition.state_config = -1;
+      shifts.push_back(transition);
+    }
+    shift_offsets.push_back(isize(shifts));
+  }
+  /* each state's shifts, followed by its reductions */
+  auto nstates = get_nstates(pip);
+  pip.action_offsets.assign(1, 0);
+  pip.actions.clear();
+  pip.state_config_states.clear();
+  reserve(pip.state_config_states, isize(state_configs));
+  for (int state_i = 0; state_i < nstates; ++state_i) {
+    pip.actions.insert(pip.actions.end(),
+        shifts.begin() + at(shift_offsets, state_i),
+        shifts.begin() + at(shift_offsets, state_i + 1));
+    for (int sc = at(offsets, state_i); sc < at(offsets, state_i + 1); ++sc) {
+      pip.state_config_states.push_back(state_i);
+      auto& config = get_config_of(pip, sc);
+      auto& prod = at(grammar.productions, config.production);
+      if (config.dot != isize(prod.rhs)) continue;
+      action_in_progress reduction;
+      reduction.action.kind = action::kind::reduce;
+      reduction.action.production = config.production;
+      reduction.symbol = -1;
+      reduction.state_config = sc;
+      pip.actions.push_back(reduction);
     }
+    pip.action_offsets.push_back(isize(pip.actions));
   }
-  add_reduction_actions(states, cs, grammar);
-  set_lr0_contexts(states, grammar);
-  return states;
+  set_lr0_lookaheads(pip);
 }
 
 static parser_graph get_productions_by_lhs(grammar const& grammar) {
-  auto nsymbols = grammar.nsymbols;
-  auto lhs2prods = make_graph_with_nnodes(nsymbols);
+  edge_list lhs2prods;
   for (int prod_i = 0; prod_i < isize(grammar.productions); ++prod_i) {
     auto& prod = at(grammar.productions, prod_i);
-    add_edge(lhs2prods, prod.lhs, prod_i);
+    lhs2prods.push_back({prod.lhs, prod_i});
   }
-  return lhs2prods;
+  return make_graph_from_edges(grammar.nsymbols, lhs2prods);
 }
 
 /* compute a graph where symbols are graph nodes, and
@@ -208,17 +282,18 @@ static parser_graph get_productions_by_lhs(grammar const& grammar) {
 static parser_graph get_symbol_graph(
     grammar const& grammar, parser_graph const& lhs2prods) {
   auto nsymbols = grammar.nsymbols;
-  auto out = make_graph_with_nnodes(nsymbols);
+  parser_graph out;
+  std::vector<int> dependees;
   for (int lhs = 0; lhs < nsymbols; ++lhs) {
-    std::set<int> dependees;
-    auto& lhs_prods = get_edges(lhs2prods, lhs);
-    for (auto prod_i : lhs_prods) {
+    dependees.clear();
+    for (auto prod_i : get_edges(lhs2prods, lhs)) {
       auto& prod = at(grammar.productions, prod_i);
-      for (auto rhs_symb : prod.rhs) {
-        dependees.insert(rhs_symb);
-      }
+      dependees.insert(dependees.end(), prod.rhs.begin(), prod.rhs.end());
     }
-    at(out, lhs).assign(dependees.begin(), dependees.end());
+    std::sort(dependees.begin(), dependees.end());
+    dependees.erase(std::unique(dependees.begin(), dependees.end()),
+        dependees.end());
+    append_node(out, dependees.begin(), dependees.end());
   }
   return out;
 }
@@ -233,7 +308,8 @@ static parser_graph get_symbol_graph(
 enum { FIRST_NULL = -425 };
 using first_set_type = std::set<int>;
 
-static void print_set(std::set<int> const& set, grammar const& grammar) {
+template <typename Set>
+static void print_set(Set const& set, grammar const& grammar) {
   std::cerr << "{";
   for (auto it = set.begin(); it != set.end(); ++it) {
     if (it != set.begin()) std::cerr << ", ";
@@ -290,8 +366,7 @@ static std::vector<first_set_type> compute_first_sets(
     if (is_terminal(grammar, symbol)) {
       event_q.push({symbol, symbol});
     } else {
-      auto& lhs_prods = get_edges(lhs2prods, symbol);
-      for (auto prod_i : lhs_prods) {
+      for (auto prod_i : get_edges(lhs2prods, symbol)) {
         auto& prod = at(grammar.productions, prod_i);
         if (prod.rhs.empty()) {
           event_q.push({FIRST_NULL, symbol});
@@ -311,12 +386,10 @@ static std::vector<first_set_type> compute_first_sets(
     /* hopefully we don't get too many duplicate events piled up... */
     if (dependee_firsts.count(added_symb)) continue;
     dependee_firsts.insert(added_symb);
-    auto& dependers = get_edges(dependees2dependers, dependee);
-    for (auto depender : dependers) {
+    for (auto depender : get_edges(dependees2dependers, dependee)) {
       assert(is_nonterminal(grammar, depender));
-      auto& prods = get_edges(lhs2prods, depender);
       auto const& depender_firsts = at(first_sets, depender);
-      for (auto prod_i : prods) {
+      for (auto prod_i : get_edges(lhs2prods, depender)) {
         auto& prod = at(grammar.productions, prod_i);
         auto rhs_first_set = get_first_set_of_string(prod.rhs, first_sets);
         for (auto rhs_first_symb : rhs_first_set) {
@@ -349,25 +422,6 @@ static std::vector<first_set_type> compute_first_sets(
   return first_sets;
 }
 
-state_configurations form_state_configs(state_in_progress_vector const& states) {
-  state_configurations out;
-  for (int i = 0; i < isize(states); ++i) {
-    auto& state = *at(states, i);
-    for (int j = 0; j < isize(state.configs); ++j) out.push_back({i, j});
-  }
-  return out;
-}
-
-parser_graph form_states_to_state_configs(
-    state_configurations const& scs, state_in_progress_vector const& states) {
-  auto out = make_graph_with_nnodes(size(states));
-  for (int i = 0; i < isize(scs); ++i) {
-    auto& sc = at(scs, i);
-    at(out, sc.state).push_back(i);
-  }
-  return out;
-}
-
 static std::string escape_dot(std::string const& s) {
   std::string out;
   for (auto c : s) {
@@ -384,10 +438,8 @@ static std::string escape_dot(std::string const& s) {
 }
 
 void print_dot(std::string const& filepath, parser_in_progress const& pip) {
-  auto& sips = pip.states;
   auto& cs = pip.configs;
   auto& grammar = pip.grammar;
-  auto& states2scs = pip.states2state_configs;
   std::cerr << "writing " << filepath << "\n\n";
   std::ofstream file(filepath.c_str());
   assert(file.is_open());
@@ -395,16 +447,17 @@ void print_dot(std::string const& filepath, parser_in_progress const& pip) {
   file << "graph [\n";
   file << "rankdir = \"LR\"\n";
   file << "]\n";
-  for (int s_i = 0; s_i < isize(sips); ++s_i) {
-    auto& state = *at(sips, s_i);
+  for (int s_i = 0; s_i < get_nstates(pip); ++s_i) {
+    auto configs = get_configs(pip, s_i);
+    auto actions = get_actions(pip, s_i);
     file << s_i << " [\n";
     file << "label = \"";
     file << "State " << s_i << "\\l";
-    for (int cis_i = 0; cis_i < isize(state.configs); ++cis_i) {
-      auto c_i = at(state.configs, cis_i);
+    for (int cis_i = 0; cis_i < isize(configs); ++cis_i) {
+      auto c_i = configs[cis_i];
       auto& config = at(cs, c_i);
       auto& prod = at(grammar->productions, config.production);
-      auto sc_i = at(states2scs, s_i, cis_i);
+      auto sc_i = get_state_config(pip, s_i, cis_i);
       file << sc_i << ": ";
       auto lhs_name = at(grammar->symbol_names, prod.lhs);
       file << escape_dot(lhs_name) << " ::= ";
@@ -419,11 +472,11 @@ void print_dot(std::string const& filepath, parser_in_progress const& pip) {
       if (config.dot == isize(prod.rhs)) {
         file << ", \\{";
         bool found = false;
-        for (auto& action : state.actions) {
+        for (auto& action : actions) {
           if (action.action.kind == action::kind::reduce &&
               action.action.production == config.production) {
             found = true;
-            auto& ac = action.context;
+            auto ac = get_context(pip, action);
             for (auto it = ac.begin(); it != ac.end(); ++it) {
               if (it != ac.begin()) file << ", ";
               auto symb = *it;
@@ -444,9 +497,9 @@ void print_dot(std::string const& filepath, parser_in_progress const& pip) {
     file << "\"\n";
     file << "shape = \"record\"\n";
     file << "]\n";
-    for (auto& action : state.actions) {
+    for (auto& action : actions) {
       if (action.action.kind == action::kind::shift) {
-        auto symb = *(action.context.begin());
+        auto symb = action.symbol;
         auto symb_name = at(grammar->symbol_names, symb);
         auto next = action.action.next_state;
         file << s_i << " -> " << next << " [\n";
@@ -458,110 +511,111 @@ void print_dot(std::string const& filepath, parser_in_progress const& pip) {
   file << "}\n";
 }
 
-static parser_graph make_immediate_predecessor_graph(state_configurations const& scs,
-    state_in_progress_vector const& states, parser_graph const& states2scs,
-    configurations const& cs, grammar_ptr grammar) {
-  auto out = make_graph_with_nnodes(size(scs));
-  for (int s_i = 0; s_i < isize(states); ++s_i) {
-    auto& state = *at(states, s_i);
-    for (int cis_i = 0; cis_i < isize(state.configs); ++cis_i) {
-      auto config_i = at(state.configs, cis_i);
+static parser_graph make_immediate_predecessor_graph(
+    parser_in_progress const& pip) {
+  auto& cs = pip.configs;
+  auto& grammar = pip.grammar;
+  edge_list out;
+  for (int s_i = 0; s_i < get_nstates(pip); ++s_i) {
+    auto configs = get_configs(pip, s_i);
+    for (int cis_i = 0; cis_i < isize(configs); ++cis_i) {
+      auto config_i = configs[cis_i];
       auto& config = at(cs, config_i);
       auto& prod = at(grammar->productions, config.production);
       auto dot = config.dot;
       if (dot == isize(prod.rhs)) continue;
       auto s = at(prod.rhs, dot);
       if (is_terminal(*grammar, s)) continue;
-      for (int cis_j = 0; cis_j < isize(state.configs); ++cis_j) {
-        auto config_j = at(state.configs, cis_j);
+      for (int cis_j = 0; cis_j < isize(configs); ++cis_j) {
+        auto config_j = configs[cis_j];
         auto& config2 = at(cs, config_j);
         auto& prod2 = at(grammar->productions, config2.production);
         if (prod2.lhs == s) {
-          auto sc_i = at(states2scs, s_i, cis_i);
-          auto sc_j = at(states2scs, s_i, cis_j);
-          add_edge(out, sc_j, sc_i);
+          auto sc_i = get_state_config(pip, s_i, cis_i);
+          auto sc_j = get_state_config(pip, s_i, cis_j);
+          out.push_back({sc_j, sc_i});
         }
       }
     }
   }
-  return out;
+  return make_graph_from_edges(get_nstate_configs(pip), out);
 }
 
-static parser_graph find_transition_predecessors(state_configurations const& scs,
-    state_in_progress_vector const& states, parser_graph const& states2scs,
-    configurations const& cs, grammar_ptr grammar) {
-  auto out = make_graph_with_nnodes(size(scs));
-  for (int state_i = 0; state_i < isize(states); ++state_i) {
-    auto& state = *at(states, state_i);
-    for (auto& action : state.actions) {
+static parser_graph find_transition_predecessors(parser_in_progress const& pip) {
+  auto& cs = pip.configs;
+  auto& grammar = pip.grammar;
+  edge_list out;
+  for (int state_i = 0; state_i < get_nstates(pip); ++state_i) {
+    auto configs = get_configs(pip, state_i);
+    for (auto& action : get_actions(pip, state_i)) {
       if (action.action.kind != action::kind::shift) continue;
-      assert(action.context.size() == 1);
-      auto symbol = *(action.context.begin());
+      auto symbol = action.symbol;
       auto state_j = action.action.next_state;
-      auto& state2 = *at(states, state_j);
-      for (int cis_i = 0; cis_i < isize(state.configs); ++cis_i) {
-        auto config_i = at(state.configs, cis_i);
+      auto configs2 = get_configs(pip, state_j);
+      for (int cis_i = 0; cis_i < isize(configs); ++cis_i) {
+        auto config_i = configs[cis_i];
         auto& config = at(cs, config_i);
-        for (int cis_j = 0; cis_j < isize(state2.configs); ++cis_j) {
-          auto config_j = at(state2.configs, cis_j);
+        for (int cis_j = 0; cis_j < isize(configs2); ++cis_j) {
+          auto config_j = configs2[cis_j];
           auto& config2 = at(cs, config_j);
           if (config.production == config2.production &&
               config.dot + 1 == config2.dot) {
             auto& prod = at(grammar->productions, config.production);
             auto rhs_symbol = at(prod.rhs, config.dot);
             if (rhs_symbol == symbol) {
-              auto sc_i = at(states2scs, state_i, cis_i);
-              auto sc_j = at(states2scs, state_j, cis_j);
-              add_edge(out, sc_j, sc_i);
+              auto sc_i = get_state_config(pip, state_i, cis_i);
+              auto sc_j = get_state_config(pip, state_j, cis_j);
+              out.push_back({sc_j, sc_i});
             }
           }
         }
       }
     }
   }
-  return out;
+  return make_graph_from_edges(get_nstate_configs(pip), out);
 }
 
-static parser_graph make_originator_graph(state_configurations const& scs,
-    state_in_progress_vector const& states, parser_graph const& states2scs,
-    configurations const& cs, grammar_ptr grammar) {
-  auto out = make_graph_with_nnodes(size(scs));
-  auto ipg =
-      make_immediate_predecessor_graph(scs, states, states2scs, cs, grammar);
-  auto tpg = find_transition_predecessors(scs, states, states2scs, cs, grammar);
-  for (auto sc_i = 0; sc_i < isize(scs); ++sc_i) {
-    std::set<int> originators;
+static parser_graph make_originator_graph(parser_in_progress const& pip) {
+  auto nscs = get_nstate_configs(pip);
+  parser_graph out;
+  auto ipg = make_immediate_predecessor_graph(pip);
+  auto tpg = find_transition_predecessors(pip);
+  /* visited[x] == sc_i marks x as reached in the search from sc_i,
+     so the marks never need to be cleared */
+  auto visited = make_vector<int>(nscs, -1);
+  std::vector<int> tpq;
+  std::vector<int> originators;
+  for (auto sc_i = 0; sc_i < nscs; ++sc_i) {
+    originators.clear();
     /* breadth-first search through the transition
        precessor graph, followed by a single hop
        along the immediate predecessor graph */
-    std::queue<int> tpq;
-    std::set<int> tps;
-    tpq.push(sc_i);
-    tps.insert(sc_i);
-    while (!tpq.empty()) {
-      auto tpp = tpq.front();
-      tpq.pop();
+    tpq.clear();
+    tpq.push_back(sc_i);
+    at(visited, sc_i) = sc_i;
+    for (int q_i = 0; q_i < isize(tpq); ++q_i) {
+      auto tpp = at(tpq, q_i);
       for (auto tpc : get_edges(tpg, tpp)) {
-        if (tps.count(tpc)) continue;
-        tpq.push(tpc);
-        tps.insert(tpc);
+        if (at(visited, tpc) == sc_i) continue;
+        tpq.push_back(tpc);
+        at(visited, tpc) = sc_i;
       }
       for (auto ip_i : get_edges(ipg, tpp)) {
-        originators.insert(ip_i);
+        originators.push_back(ip_i);
       }
     }
-    at(out, sc_i).assign(originators.begin(), originators.end());
+    std::sort(originators.begin(), originators.end());
+    originators.erase(std::unique(originators.begin(), originators.end()),
+        originators.end());
+    append_node(out, originators.begin(), originators.end());
   }
   return out;
 }
 
-static std::vector<int> get_follow_string(int sc_addr, state_configurations const& scs,
-    state_in_progress_vector const& states, configurations const& cs, grammar_ptr grammar) {
-  auto& sc = at(scs, sc_addr);
-  auto& state = *at(states, sc.state);
-  auto config_i = at(state.configs, sc.config_in_state);
-  auto& config = at(cs, config_i);
-  auto& prod = at(grammar->productions, config.production);
+static std::vector<int> get_follow_string(
+    int sc_addr, parser_in_progress const& pip) {
+  auto& config = get_config_of(pip, sc_addr);
+  auto& prod = at(pip.grammar->productions, config.production);
   auto out_size = isize(prod.rhs) - (config.dot + 1);
   std::vector<int> out;
   /* out_size can be negative */
@@ -588,10 +642,12 @@ static bool has_non_null_terminal_descendant(first_set_type const& first_set) {
   return *(first_set.begin()) != FIRST_NULL;
 }
 
-static context_type get_contexts(first_set_type first_set) {
-  auto it = first_set.find(FIRST_NULL);
-  if (it != first_set.end()) first_set.erase(it);
-  return first_set;
+static context_type get_contexts(first_set_type const& first_set) {
+  context_type out;
+  for (auto symb : first_set) {
+    if (symb != FIRST_NULL) out.push_back(symb);
+  }
+  return out;
 }
 
 enum { MARKER = -433 };
@@ -635,6 +691,17 @@ static void move_markers(std::vector<int>& lane, int zeta_prime_addr,
 
 using context_types = std::vector<context_type>;
 
+/* IN_LANE flags, shared by all calls of compute_context_set.
+   a state-configuration is in the lane of the current call
+   if its owner is that call's zeta_j, so nothing needs to be
+   cleared between calls */
+struct lane_membership {
+  std::vector<int> owners;
+  int current;
+  bool get(int sc) const { return at(owners, sc) == current; }
+  void set(int sc, bool value) { at(owners, sc) = value ? current : -1; }
+};
+
 static void context_adding_routine(std::vector<int> const& lane,
     int zeta_pointer, context_type& contexts_generated, context_types& contexts,
     bool verbose, grammar_ptr grammar) {
@@ -684,7 +751,7 @@ static void context_adding_routine(std::vector<int> const& lane,
 
 static void deal_with_tests_failed(int& num_originators_failed,
     int& first_originator_failed, int zeta_prime_addr, bool& tests_failed,
-    std::vector<int>& lane, std::vector<bool>& in_lane, int zeta_addr,
+    std::vector<int>& lane, lane_membership& in_lane, int zeta_addr,
     std::vector<int>& stack, bool verbose) {
   if (verbose) std::cerr << "  Dealing with test failures\n";
   if (num_originators_failed == 0) {
@@ -696,7 +763,7 @@ static void deal_with_tests_failed(int& num_originators_failed,
       std::cerr << "    pushing " << zeta_prime_addr << " onto LANE:\n    ";
     lane.push_back(zeta_prime_addr);
     if (verbose) print_stack(lane);
-    at(in_lane, zeta_prime_addr) = true;
+    in_lane.set(zeta_prime_addr, true);
     if (verbose) std::cerr << "    IN_LANE(" << zeta_prime_addr << ") <- ON\n";
     tests_failed = true;
     if (verbose) std::cerr << "    TESTS_FAILED <- ON\n";
@@ -736,35 +803,39 @@ static void deal_with_tests_failed(int& num_originators_failed,
 }
 
 static void heuristic_propagation_of_context_sets(int tau_addr,
-    context_types& contexts, std::vector<bool>& complete, state_configurations const& scs,
-    state_in_progress_vector const& states, parser_graph const& states2scs,
-    configurations const& cs, grammar_ptr grammar) {
-  auto& tau = at(scs, tau_addr);
-  auto& state = *at(states, tau.state);
-  auto config_i = at(state.configs, tau.config_in_state);
+    context_types& contexts, std::vector<bool>& complete,
+    parser_in_progress const& pip) {
+  auto& cs = pip.configs;
+  auto& grammar = pip.grammar;
+  auto tau_state = at(pip.state_config_states, tau_addr);
+  auto configs = get_configs(pip, tau_state);
+  auto config_i = at(pip.state_configs, tau_addr);
   auto& config = at(cs, config_i);
   if (config.dot != 0) return;
   auto& prod = at(grammar->productions, config.production);
-  for (int cis_j = 0; cis_j < isize(state.configs); ++cis_j) {
-    auto config_j = at(state.configs, cis_j);
+  for (int cis_j = 0; cis_j < isize(configs); ++cis_j) {
+    auto config_j = configs[cis_j];
     if (config_j == config_i) continue;
     auto& config2 = at(cs, config_j);
     if (config2.dot != 0) continue;
     auto& prod2 = at(grammar->productions, config2.production);
     if (prod.lhs != prod2.lhs) continue;
-    auto tau_prime_addr = at(states2scs, tau.state, cis_j);
+    auto tau_prime_addr = get_state_config(pip, tau_state, cis_j);
     at(contexts, tau_prime_addr) = at(contexts, tau_addr);
     at(complete, tau_prime_addr) = true;
   }
 }
 
 /* Here it is! The magical algorithm described by a flowchart in
-   Figure 7 of David Pager's paper. */
-static void compute_context_set(int zeta_j_addr, context_types& contexts,
-    std::vector<bool>& complete, state_configurations const& scs,
-    parser_graph const& originator_graph, state_in_progress_vector const& states,
-    parser_graph const& states2scs, configurations const& cs,
-    std::vector<first_set_type> const& first_sets, grammar_ptr grammar, bool verbose) {
+   Figure 7 of David Pager's paper.
+   Returns the failure if the grammar turns out to be ambiguous. */
+static build_failure_ptr compute_context_set(int zeta_j_addr,
+    context_types& contexts, std::vector<bool>& complete,
+    lane_membership& in_lane, parser_graph const& originator_graph,
+    parser_in_progress const& pip,
+    std::vector<first_set_type> const& first_sets, bool verbose,
+    build_profile* profile) {
+  auto& grammar = pip.grammar;
   if (verbose)
     std::cerr << "Computing context set for $\\zeta_j$ = " << zeta_j_addr
               << "...\n";
@@ -772,14 +843,14 @@ static void compute_context_set(int zeta_j_addr, context_types& contexts,
   if (at(complete, zeta_j_addr)) {
     if (verbose)
       std::cerr << zeta_j_addr << " was already complete!\nEND PROGRAM\n\n";
-    return;
+    return nullptr;
   }
   std::vector<int> stack;
   // need random access, inner insert, which std::stack doesn't provide
   std::vector<int> lane;
-  auto in_lane = make_vector<bool>(size(scs), false);
+  in_lane.current = zeta_j_addr;
   lane.push_back(zeta_j_addr);
-  at(in_lane, zeta_j_addr) = true;
+  in_lane.set(zeta_j_addr, true);
   bool tests_failed = false;
   context_type contexts_generated;
   if (verbose) {
@@ -794,16 +865,22 @@ static void compute_context_set(int zeta_j_addr, context_types& contexts,
     }
     auto zeta_pointer = isize(lane) - 1;
     if (verbose) std::cerr << "$\\zeta$-POINTER <- " << zeta_pointer << '\n';
+    if (profile) {
+      profile->max_lane_size = std::max(profile->max_lane_size, isize(lane));
+      profile->max_lane_stack_size =
+        std::max(profile->max_lane_stack_size, isize(stack));
+    }
     int num_originators_failed = 0;
     int first_originator_failed = -1;
     if (verbose) std::cerr << "DO_LOOP:\n";
     /* DO_LOOP */
     for (auto zeta_prime_addr : get_edges(originator_graph, zeta_addr)) {
+      if (profile) ++profile->lane_tracing_steps;
       if (verbose) {
         std::cerr << "Next originator of $\\zeta$ = " << zeta_addr
                   << " is $\\zeta'$ = " << zeta_prime_addr << '\n';
       }
-      auto gamma = get_follow_string(zeta_prime_addr, scs, states, cs, grammar);
+      auto gamma = get_follow_string(zeta_prime_addr, pip);
       if (verbose) {
         std::cerr << "  FOLLOW string of $\\zeta'$ = " << zeta_prime_addr
                   << " is ";
@@ -842,7 +919,7 @@ static void compute_context_set(int zeta_j_addr, context_types& contexts,
             unite_with(contexts_generated, at(contexts, zeta_prime_addr));
             context_adding_routine(lane, zeta_pointer, contexts_generated,
                 contexts, verbose, grammar);
-          } else if (!at(in_lane, zeta_prime_addr)) {
+          } else if (!in_lane.get(zeta_prime_addr)) {
             context_adding_routine(lane, zeta_pointer, contexts_generated,
                 contexts, verbose, grammar);
             /* TRACE_FURTHER */
@@ -850,8 +927,9 @@ static void compute_context_set(int zeta_j_addr, context_types& contexts,
                 first_originator_failed, zeta_prime_addr, tests_failed, lane,
                 in_lane, zeta_addr, stack, verbose);
           } else {
-            std::cerr << "ERROR: grammar is ambiguous.\n";
-            abort();
+            return std::make_shared<build_failure const>(
+                build_failure::kind::ambiguous_grammar, grammar,
+                at(pip.state_config_states, zeta_prime_addr));
           }
         } else {
           context_adding_routine(lane, zeta_pointer, contexts_generated,
@@ -872,7 +950,7 @@ static void compute_context_set(int zeta_j_addr, context_types& contexts,
         } else {
           if (verbose)
             std::cerr << "  COMPLETE(" << zeta_prime_addr << ") is OFF\n";
-          if (at(in_lane, zeta_prime_addr)) {  // test C
+          if (in_lane.get(zeta_prime_addr)) {  // test C
             if (verbose)
               std::cerr << "  IN_LANE(" << zeta_prime_addr << ") is ON\n";
             move_markers(lane, zeta_prime_addr, zeta_pointer, tests_failed);
@@ -936,7 +1014,7 @@ static void compute_context_set(int zeta_j_addr, context_types& contexts,
             if (verbose) std::cerr << "    Push " << addr << " onto LANE\n";
             lane.push_back(addr);
             if (verbose) std::cerr << "    IN_LANE(" << addr << ") <- ON\n";
-            at(in_lane, addr) = true;
+            in_lane.set(addr, true);
             keep_lane_popping = false;
             break;  // out of STACK and LANE popping, into top-level loop
           }         // end STACK top checks
@@ -950,16 +1028,15 @@ static void compute_context_set(int zeta_j_addr, context_types& contexts,
         auto tau_addr = lane.back();
         if (verbose)
           std::cerr << "  Top of LANE is $\\tau$ = " << tau_addr << "\n";
-        at(in_lane, tau_addr) = false;
+        in_lane.set(tau_addr, false);
         if (verbose) std::cerr << "  IN_LANE(" << tau_addr << ") <- OFF\n";
         at(complete, tau_addr) = true;
         if (verbose) std::cerr << "  COMPLETE(" << tau_addr << ") <- ON\n";
         if (verbose) std::cerr << "  HEURISTIC PROPAGATION OF CONTEXT SETS\n";
-        heuristic_propagation_of_context_sets(
-            tau_addr, contexts, complete, scs, states, states2scs, cs, grammar);
+        heuristic_propagation_of_context_sets(tau_addr, contexts, complete, pip);
         if (size(lane) == 1 && at(lane, 0) == zeta_j_addr) {
           if (verbose) std::cerr << "END PROGRAM\n\n";
-          return;
+          return nullptr;
         }
         if (verbose) std::cerr << "  Pop LANE\n";
         resize(lane, isize(lane) - 1);  // pop LANE
@@ -969,25 +1046,27 @@ static void compute_context_set(int zeta_j_addr, context_types& contexts,
   }      // end top-level while(1) loop
 }
 
+static bool is_nonterminal_transition(
+    parser_in_progress const& pip, action_in_progress const& action) {
+  return action.action.kind == action::kind::shift &&
+         is_nonterminal(*pip.grammar, action.symbol);
+}
+
 static std::vector<bool> determine_adequate_states(
-    state_in_progress_vector const& states, grammar_ptr grammar, bool verbose) {
-  auto out = make_vector<bool>(size(states));
-  for (int s_i = 0; s_i < isize(states); ++s_i) {
-    auto& state = *at(states, s_i);
+    parser_in_progress const& pip, bool verbose) {
+  auto& grammar = pip.grammar;
+  auto out = make_vector<bool>(get_nstates(pip));
+  for (int s_i = 0; s_i < get_nstates(pip); ++s_i) {
+    auto actions = get_actions(pip, s_i);
     bool state_is_adequate = true;
-    for (int a_i = 0; a_i < isize(state.actions); ++a_i) {
-      auto& action = at(state.actions, a_i);
-      if (action.action.kind == action::kind::shift &&
-          is_nonterminal(*grammar, *(action.context.begin()))) {
-        continue;
-      }
-      for (int a_j = a_i + 1; a_j < isize(state.actions); ++a_j) {
-        auto& action2 = at(state.actions, a_j);
-        if (action2.action.kind == action::kind::shift &&
-            is_nonterminal(*grammar, *(action2.context.begin()))) {
-          continue;
-        }
-        if (intersects(action2.context, action.context)) {
+    for (int a_i = 0; a_i < isize(actions); ++a_i) {
+      auto& action = actions[a_i];
+      if (is_nonterminal_transition(pip, action)) continue;
+      for (int a_j = a_i + 1; a_j < isize(actions); ++a_j) {
+        auto& action2 = actions[a_j];
+        if (is_nonterminal_transition(pip, action2)) continue;
+        if (sorted_intersects(
+                get_context(pip, action2), get_context(pip, action))) {
           if (verbose) {
             auto* ap1 = &action;
             auto* ap2 = &action2;
@@ -1004,7 +1083,7 @@ static std::vector<bool> determine_adequate_states(
               auto& rhs_symb_name = at(grammar->symbol_names, rhs_symb);
               std::cerr << " " << rhs_symb_name;
             }
-            auto shift_symb = *(ap2->context.begin());
+            auto shift_symb = get_context(pip, *ap2).front();
             auto shift_name = at(grammar->symbol_names, shift_symb);
             std::cerr << "\nshift " << shift_name << '\n';
           }
@@ -1020,86 +1099,160 @@ static std::vector<bool> determine_adequate_states(
   return out;
 }
 
-parser_in_progress build_lalr1_parser(grammar_ptr grammar, bool verbose) {
+/* records every pair of actions in an inadequate state that share
+   a lookahead terminal, keeping only indices so that nothing is
+   printed or written unless the user asks for a description */
+static std::vector<lalr1_conflict> find_conflicts(
+    parser_in_progress const& pip, std::vector<bool> const& adequate) {
+  std::vector<lalr1_conflict> out;
+  for (int s_i = 0; s_i < get_nstates(pip); ++s_i) {
+    if (at(adequate, s_i)) continue;
+    auto actions = get_actions(pip, s_i);
+    for (int a_i = 0; a_i < isize(actions); ++a_i) {
+      auto* ap1 = &actions[a_i];
+      if (is_nonterminal_transition(pip, *ap1)) continue;
+      auto context1 = get_context(pip, *ap1);
+      for (int a_j = a_i + 1; a_j < isize(actions); ++a_j) {
+        auto* ap2 = &actions[a_j];
+        if (is_nonterminal_transition(pip, *ap2)) continue;
+        auto context2 = get_context(pip, *ap2);
+        auto it = std::find_first_of(context1.begin(), context1.end(),
+            context2.begin(), context2.end());
+        if (it == context1.end()) continue;
+        auto* first = ap1;
+        auto* second = ap2;
+        if (first->action.kind == action::kind::shift) std::swap(first, second);
+        out.push_back({s_i, *it, first->action, second->action});
+      }
+    }
+  }
+  return out;
+}
+
+/* replaces the LR(0) lookaheads of every reduction whose
+   state-configuration has a complete context set */
+static void set_lalr1_lookaheads(parser_in_progress& pip,
+    context_types const& contexts, std::vector<bool> const& complete) {
+  auto& grammar = *pip.grammar;
+  std::vector<int> offsets(1, 0);
+  std::vector<int> lookaheads;
+  reserve(offsets, get_nstate_configs(pip) + 1);
+  for (int sc = 0; sc < get_nstate_configs(pip); ++sc) {
+    auto& config = get_config_of(pip, sc);
+    auto& prod = at(grammar.productions, config.production);
+    if (config.dot == isize(prod.rhs)) {
+      if (at(complete, sc)) {
+        auto& context = at(contexts, sc);
+        lookaheads.insert(lookaheads.end(), context.begin(), context.end());
+      } else {
+        lookaheads.insert(lookaheads.end(),
+            pip.lookaheads.begin() + at(pip.lookahead_offsets, sc),
+            pip.lookaheads.begin() + at(pip.lookahead_offsets, sc + 1));
+      }
+    }
+    offsets.push_back(isize(lookaheads));
+  }
+  pip.lookahead_offsets.swap(offsets);
+  pip.lookaheads.swap(lookaheads);
+}
+
+parser_in_progress build_lalr1_parser(
+    grammar_ptr grammar, bool verbose, build_profile* profile) {
+  build_failure_ptr failure;
+  auto out = build_lalr1_parser(grammar, failure, verbose, profile);
+  if (failure) throw build_error(failure);
+  return out;
+}
+
+parser_in_progress build_lalr1_parser(grammar_ptr grammar,
+    build_failure_ptr& failure, bool verbose, build_profile* profile) {
   parser_in_progress out;
   auto& cs = out.configs;
-  auto& states = out.states;
-  auto& scs = out.state_configs;
-  auto& states2scs = out.states2state_configs;
   out.grammar = grammar;
   cs = make_configs(*grammar);
   auto lhs2cs = get_left_hand_sides_to_start_configs(cs, *grammar);
   if (verbose) std::cerr << "Building LR(0) parser\n";
-  states = build_lr0_parser(cs, *grammar, lhs2cs);
-  scs = form_state_configs(states);
-  states2scs = form_states_to_state_configs(scs, states);
+  phase_timer lr0_timer(profile, "lr0");
+  build_lr0_parser(out, lhs2cs);
   if (verbose) print_dot("lr0.dot", out);
   if (verbose) std::cerr << "Checking adequacy of LR(0) machine\n";
-  auto adequate = determine_adequate_states(states, grammar, verbose);
+  auto adequate = determine_adequate_states(out, verbose);
+  lr0_timer.stop();
+  auto nstates = get_nstates(out);
+  auto nscs = get_nstate_configs(out);
+  if (profile) {
+    profile->nconfigs = isize(cs);
+    profile->lr0_states = nstates;
+    profile->nstate_configs = nscs;
+    profile->inadequate_lr0_states =
+      int(std::count(adequate.begin(), adequate.end(), false));
+  }
   if (*(std::min_element(adequate.begin(), adequate.end()))) {
     if (verbose) std::cerr << "The grammar is LR(0)!\n";
     return out;
   }
-  auto complete = make_vector<bool>(size(scs), false);
-  auto contexts = make_vector<context_type>(size(scs));
+  auto complete = make_vector<bool>(nscs, false);
+  auto contexts = make_vector<context_type>(nscs);
   auto accept_prod_i = get_accept_production(*grammar);
   /* initialize the accepting state-configs as described in
      footnote 8 at the bottom of page 37 */
-  for (int sc_i = 0; sc_i < isize(scs); ++sc_i) {
-    auto& sc = at(scs, sc_i);
-    auto& state = *at(states, sc.state);
-    auto config_i = at(state.configs, sc.config_in_state);
-    auto& config = at(cs, config_i);
+  for (int sc_i = 0; sc_i < nscs; ++sc_i) {
+    auto& config = get_config_of(out, sc_i);
     if (config.production == accept_prod_i) {
       at(complete, sc_i) = true;
-      at(contexts, sc_i).insert(get_end_terminal(*grammar));
+      at(contexts, sc_i).push_back(get_end_terminal(*grammar));
+    }
+  }
+  phase_timer first_timer(profile, "first_sets");
+  auto first_sets = compute_first_sets(*grammar, verbose);
+  first_timer.stop();
+  if (profile) {
+    for (auto& first_set : first_sets) {
+      profile->max_first_set_size =
+        std::max(profile->max_first_set_size, int(first_set.size()));
     }
   }
-  auto og = make_originator_graph(scs, states, states2scs, cs, grammar);
+  phase_timer lookahead_timer(profile, "lookahead");
+  auto og = make_originator_graph(out);
   if (verbose) std::cerr << "Originator parser_graph:\n";
   if (verbose) std::cerr << og << '\n';
-  auto first_sets = compute_first_sets(*grammar, verbose);
+  lane_membership in_lane;
+  in_lane.owners = make_vector<int>(nscs, -1);
+  in_lane.current = -1;
   /* compute context sets for all state-configs associated with reduction
      actions that are part of an inadequate state */
-  for (int s_i = 0; s_i < isize(states); ++s_i) {
+  for (int s_i = 0; s_i < nstates; ++s_i) {
     if (at(adequate, s_i)) continue;
-    auto& state = *at(states, s_i);
-    for (int cis_i = 0; cis_i < isize(state.configs); ++cis_i) {
-      auto config_i = at(state.configs, cis_i);
+    auto configs = get_configs(out, s_i);
+    for (int cis_i = 0; cis_i < isize(configs); ++cis_i) {
+      auto config_i = configs[cis_i];
       auto& config = at(cs, config_i);
       auto& prod = at(grammar->productions, config.production);
       if (config.dot != isize(prod.rhs)) continue;
-      auto zeta_j_addr = at(states2scs, s_i, cis_i);
-      compute_context_set(zeta_j_addr, contexts, complete, scs, og, states,
-          states2scs, cs, first_sets, grammar, verbose);
+      auto zeta_j_addr = get_state_config(out, s_i, cis_i);
+      failure = compute_context_set(zeta_j_addr, contexts, complete,
+          in_lane, og, out, first_sets, verbose, profile);
+      if (failure) return out;
     }
   }
   /* update the context sets for all reduction state-configs
      which are marked complete, even if they aren't in inadequate states */
-  for (int s_i = 0; s_i < isize(states); ++s_i) {
-    auto& state = *at(states, s_i);
-    for (int cis_i = 0; cis_i < isize(state.configs); ++cis_i) {
-      auto sc_i = at(states2scs, s_i, cis_i);
-      if (!at(complete, sc_i)) continue;
-      auto config_i = at(state.configs, cis_i);
-      auto& config = at(cs, config_i);
-      auto& prod = at(grammar->productions, config.production);
-      if (config.dot != isize(prod.rhs)) continue;
-      for (auto& action : state.actions) {
-        if (action.action.kind == action::kind::reduce &&
-            action.action.production == config.production) {
-          action.context = at(contexts, sc_i);
-        }
-      }
+  set_lalr1_lookaheads(out, contexts, complete);
+  if (profile) {
+    for (auto& context : contexts) {
+      profile->max_context_set_size =
+        std::max(profile->max_context_set_size, isize(context));
     }
   }
   if (verbose) std::cerr << "Checking adequacy of LALR(1) machine\n";
-  adequate = determine_adequate_states(states, grammar, verbose);
+  adequate = determine_adequate_states(out, verbose);
+  lookahead_timer.stop();
   if (!(*(std::min_element(adequate.begin(), adequate.end())))) {
-    std::cerr << "ERROR: The grammar is not LALR(1).\n";
-    determine_adequate_states(states, grammar, true);
-    print_dot("error.dot", out);
-    abort();
+    if (verbose) print_dot("error.dot", out);
+    failure = std::make_shared<build_failure const>(
+        build_failure::kind::not_lalr1, grammar, -1,
+        find_conflicts(out, adequate));
+    return out;
   }
   if (verbose) std::cerr << "The grammar is LALR(1)!\n";
   if (verbose) print_dot("lalr1.dot", out);
@@ -1107,31 +1260,34 @@ parser_in_progress build_lalr1_parser(grammar_ptr grammar, bool verbose) {
 }
 
 shift_reduce_tables accept_parser(parser_in_progress const& pip) {
-  auto& sips = pip.states;
   auto& grammar = pip.grammar;
-  auto out = shift_reduce_tables(grammar, isize(sips));
-  for (int s_i = 0; s_i < isize(sips); ++s_i) {
+  auto nstates = get_nstates(pip);
+  auto out = shift_reduce_tables(grammar, nstates);
+  for (int s_i = 0; s_i < nstates; ++s_i) {
     add_state(out);
   }
-  for (int s_i = 0; s_i < isize(sips); ++s_i) {
-    auto& sip = *at(sips, s_i);
-    for (auto& action : sip.actions) {
-      if (action.action.kind == action::kind::shift &&
-          is_nonterminal(*grammar, *(action.context.begin()))) {
-        auto nt = as_nonterminal(*grammar, *(action.context.begin()));
+  for (int s_i = 0; s_i < nstates; ++s_i) {
+    /* ignored terminals are skipped in every state, even where an
+       LR(0) reduction context would otherwise claim them */
+    for (auto terminal : grammar->ignored_terminals) {
+      assert(is_terminal(*grammar, terminal));
+      parsegen::action action;
+      action.kind = action::kind::skip;
+      add_terminal_action(out, s_i, terminal, action);
+    }
+    for (auto& action : get_actions(pip, s_i)) {
+      if (is_nonterminal_transition(pip, action)) {
+        auto nt = as_nonterminal(*grammar, action.symbol);
         add_nonterminal_action(out, s_i, nt, action.action.next_state);
       } else {
-        for (auto terminal : action.context) {
+        for (auto terminal : get_context(pip, action)) {
           assert(is_terminal(*grammar, terminal));
+          if (get_action(out, s_i, terminal).kind == action::kind::skip) {
+            continue;
+          }
           add_terminal_action(out, s_i, terminal, action.action);
         }
       }
-      for (auto terminal : grammar->ignored_terminals) {
-        assert(is_terminal(*grammar, terminal));
-        parsegen::action action;
-        action.kind = action::kind::skip;
-        add_terminal_action(out, s_i, terminal, action);
-      }
     }
   }
   return out;
@@ -1,10 +1,13 @@
 #pragma once
 
 #include <memory>
-#include <set>
+#include <vector>
 
+#include "parsegen_build_profile.hpp"
+#include "parsegen_build_result.hpp"
 #include "parsegen_shift_reduce_tables.hpp"
 #include "parsegen_parser_graph.hpp"
+#include "parsegen_span.hpp"
 
 namespace parsegen {
 
@@ -15,44 +18,62 @@ struct configuration {
 
 using configurations = std::vector<configuration>;
 
-using context_type = std::set<int>;
+/* a sorted set of terminals */
+using context_type = std::vector<int>;
 
 /* nonterminal transitions will be stored as SHIFT
    actions while in progress */
 struct action_in_progress {
   parsegen::action action;
-  context_type context;
+  /* the symbol a SHIFT is taken on, -1 for reductions */
+  int symbol;
+  /* the state-configuration a REDUCE comes from, -1 for shifts.
+     its lookaheads are the context of the reduction */
+  int state_config;
 };
 
-struct state_in_progress {
-  std::vector<int> configs;
-  std::vector<action_in_progress> actions;
-};
-
-using state_in_progress_vector = std::vector<std::unique_ptr<state_in_progress>>;
-
-struct state_configuration {
-  int state;
-  int config_in_state;
-};
-
-using state_configurations = std::vector<state_configuration>;
-
+/* The machine under construction is kept in flat arrays in
+   compressed sparse row form: the items of row i of an
+   (offsets, data) pair are data[offsets[i]] through
+   data[offsets[i + 1] - 1].
+   A state-configuration is identified by its position in
+   state_configs, so the j-th configuration of state s is
+   state-configuration state_config_offsets[s] + j. */
 struct parser_in_progress {
-  state_in_progress_vector states;
   configurations configs;
-  state_configurations state_configs;
-  parser_graph states2state_configs;
+  /* state -> configurations */
+  std::vector<int> state_config_offsets;
+  std::vector<int> state_configs;
+  /* state-configuration -> state */
+  std::vector<int> state_config_states;
+  /* state -> actions */
+  std::vector<int> action_offsets;
+  std::vector<action_in_progress> actions;
+  /* state-configuration -> lookahead terminals,
+     empty unless the configuration is a reduction */
+  std::vector<int> lookahead_offsets;
+  std::vector<int> lookaheads;
   grammar_ptr grammar;
 };
 
-state_configurations form_state_configs(state_in_progress_vector const& states);
-parser_graph form_states_to_state_configs(
-    state_configurations const& scs, state_in_progress_vector const& states);
+int get_nstates(parser_in_progress const& pip);
+int get_nstate_configs(parser_in_progress const& pip);
+span<int const> get_configs(parser_in_progress const& pip, int state);
+span<action_in_progress const> get_actions(
+    parser_in_progress const& pip, int state);
+/* the terminals (or the one nonterminal) an action is taken on */
+span<int const> get_context(
+    parser_in_progress const& pip, action_in_progress const& action);
 
 void print_dot(std::string const& filepath, parser_in_progress const& pip);
 
-parser_in_progress build_lalr1_parser(grammar_ptr grammar, bool verbose = false);
+parser_in_progress build_lalr1_parser(grammar_ptr grammar,
+    bool verbose = false, build_profile* profile = nullptr);
+/* an ambiguous or non-LALR(1) grammar sets failure, and the
+   machine returned is then not usable */
+parser_in_progress build_lalr1_parser(grammar_ptr grammar,
+    build_failure_ptr& failure, bool verbose = false,
+    build_profile* profile = nullptr);
 
 shift_reduce_tables accept_parser(parser_in_progress const& pip);
 
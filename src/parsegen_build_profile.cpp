@@ -0,0 +1,64 @@
+#include "parsegen_build_profile.hpp"
+
+#include <iostream>
+
+namespace parsegen {
+
+double build_profile::total_seconds() const {
+  double total = 0.0;
+  for (auto& p : phases) total += p.seconds;
+  return total;
+}
+
+phase_timer::phase_timer(build_profile* profile_arg, char const* name_arg)
+  :m_profile(profile_arg)
+  ,m_phase(0)
+{
+  if (!m_profile) return;
+  m_phase = m_profile->phases.size();
+  m_profile->phases.push_back({name_arg, 0.0});
+  m_start = std::chrono::steady_clock::now();
+}
+
+phase_timer::~phase_timer() {
+  stop();
+}
+
+void phase_timer::stop() noexcept {
+  if (!m_profile) return;
+  std::chrono::duration<double> elapsed =
+    std::chrono::steady_clock::now() - m_start;
+  m_profile->phases[m_phase].seconds = elapsed.count();
+  m_profile = nullptr;
+}
+
+void write_json(std::ostream& os, build_profile const& profile) {
+  os << "{\n";
+  os << "  \"phases\": [\n";
+  for (std::size_t i = 0; i < profile.phases.size(); ++i) {
+    auto& p = profile.phases[i];
+    /* phase names are fixed identifiers, no escaping needed */
+    os << "    {\"name\": \"" << p.name << "\", \"seconds\": " << p.seconds << "}";
+    os << (i + 1 < profile.phases.size() ? ",\n" : "\n");
+  }
+  os << "  ],\n";
+  os << "  \"total_seconds\": " << profile.total_seconds() << ",\n";
+  os << "  \"ntokens\": " << profile.ntokens << ",\n";
+  os << "  \"nproductions\": " << profile.nproductions << ",\n";
+  os << "  \"token_dfa_states\": " << profile.token_dfa_states << ",\n";
+  os << "  \"nfa_states\": " << profile.nfa_states << ",\n";
+  os << "  \"dfa_states\": " << profile.dfa_states << ",\n";
+  os << "  \"minimized_dfa_states\": " << profile.minimized_dfa_states << ",\n";
+  os << "  \"nconfigs\": " << profile.nconfigs << ",\n";
+  os << "  \"lr0_states\": " << profile.lr0_states << ",\n";
+  os << "  \"nstate_configs\": " << profile.nstate_configs << ",\n";
+  os << "  \"inadequate_lr0_states\": " << profile.inadequate_lr0_states << ",\n";
+  os << "  \"max_first_set_size\": " << profile.max_first_set_size << ",\n";
+  os << "  \"lane_tracing_steps\": " << profile.lane_tracing_steps << ",\n";
+  os << "  \"max_lane_size\": " << profile.max_lane_size << ",\n";
+  os << "  \"max_lane_stack_size\": " << profile.max_lane_stack_size << ",\n";
+  os << "  \"max_context_set_size\": " << profile.max_context_set_size << "\n";
+  os << "}\n";
+}
+
+}  // namespace parsegen
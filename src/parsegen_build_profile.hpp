@@ -0,0 +1,63 @@
+#ifndef PARSEGEN_BUILD_PROFILE_HPP
+#define PARSEGEN_BUILD_PROFILE_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace parsegen {
+
+/* where the time and memory of build_parser_tables go.
+   phases are recorded in the order they run; the counts are
+   the sizes of the intermediate objects, which is what drives
+   the memory use of each phase */
+struct build_profile {
+  struct phase {
+    std::string name;
+    double seconds;
+  };
+  std::vector<phase> phases;
+  int ntokens = 0;
+  int nproductions = 0;
+  /* summed over the individual token DFAs */
+  int token_dfa_states = 0;
+  int nfa_states = 0;
+  int dfa_states = 0;
+  int minimized_dfa_states = 0;
+  int nconfigs = 0;
+  int lr0_states = 0;
+  int nstate_configs = 0;
+  int inadequate_lr0_states = 0;
+  int max_first_set_size = 0;
+  /* originators examined by the lane-tracing DO_LOOP */
+  long lane_tracing_steps = 0;
+  int max_lane_size = 0;
+  int max_lane_stack_size = 0;
+  int max_context_set_size = 0;
+  double total_seconds() const;
+};
+
+/* appends a phase to the profile (if any) when started and
+   records its duration when stopped or destroyed.
+   only the constructor allocates, so stop() and the destructor
+   cannot throw; stop() may be called before destruction and
+   any call after the first does nothing */
+class phase_timer {
+  build_profile* m_profile;
+  std::size_t m_phase;
+  std::chrono::steady_clock::time_point m_start;
+ public:
+  phase_timer(build_profile* profile_arg, char const* name_arg);
+  phase_timer(phase_timer const&) = delete;
+  phase_timer& operator=(phase_timer const&) = delete;
+  ~phase_timer();
+  void stop() noexcept;
+};
+
+void write_json(std::ostream& os, build_profile const& profile);
+
+}  // namespace parsegen
+
+#endif
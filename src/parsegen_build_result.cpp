@@ -0,0 +1,111 @@
+#include "parsegen_build_result.hpp"
+
+#include <sstream>
+
+#include "parsegen_std_vector.hpp"
+
+namespace parsegen {
+
+build_failure::build_failure(
+    build_failure::kind kind_arg, std::string const& message_arg)
+  :m_kind(kind_arg)
+  ,m_message(message_arg)
+  ,m_state(-1)
+{
+}
+
+build_failure::build_failure(build_failure::kind kind_arg,
+    grammar_ptr grammar_arg, int state_arg,
+    std::vector<lalr1_conflict>&& conflicts_arg)
+  :m_kind(kind_arg)
+  ,m_grammar(grammar_arg)
+  ,m_state(state_arg)
+  ,m_conflicts(std::move(conflicts_arg))
+{
+}
+
+static void describe_production(
+    std::ostream& os, grammar const& g, int production) {
+  auto& prod = at(g.productions, production);
+  os << at(g.symbol_names, prod.lhs) << " ::=";
+  for (auto symb : prod.rhs) os << " " << at(g.symbol_names, symb);
+}
+
+static void describe_action(
+    std::ostream& os, grammar const& g, action const& a, int terminal) {
+  if (a.kind == action::kind::shift) {
+    os << "shift " << at(g.symbol_names, terminal)
+       << " and go to state " << a.next_state;
+  } else {
+    os << "reduce ";
+    describe_production(os, g, a.production);
+  }
+}
+
+std::string build_failure::describe() const {
+  std::stringstream ss;
+  switch (m_kind) {
+    case build_failure::kind::invalid_language:
+      ss << m_message;
+      break;
+    case build_failure::kind::ambiguous_grammar:
+      ss << "ERROR: grammar is ambiguous (found while computing "
+            "lookaheads for state " << m_state << ")\n";
+      break;
+    case build_failure::kind::not_lalr1:
+      ss << "ERROR: The grammar is not LALR(1).\n";
+      for (auto& conflict : m_conflicts) {
+        auto is_shift = conflict.second.kind == action::kind::shift;
+        ss << (is_shift ? "shift-reduce" : "reduce-reduce")
+           << " conflict in state " << conflict.state << " on lookahead "
+           << at(m_grammar->symbol_names, conflict.terminal) << ":\n  ";
+        describe_action(ss, *m_grammar, conflict.first, conflict.terminal);
+        ss << "\n  ";
+        describe_action(ss, *m_grammar, conflict.second, conflict.terminal);
+        ss << '\n';
+      }
+      break;
+  }
+  return ss.str();
+}
+
+build_error::build_error(build_failure&& failure_arg)
+  :build_error(std::make_shared<build_failure const>(std::move(failure_arg)))
+{
+}
+
+build_error::build_error(build_failure_ptr failure_arg)
+  :std::invalid_argument("parsegen::build_error")
+  ,m_failure(std::move(failure_arg))
+  ,m_description(std::make_shared<description>())
+{
+}
+
+char const* build_error::what() const noexcept {
+  try {
+    std::call_once(m_description->once, [this] {
+      m_description->text = m_failure->describe();
+    });
+  } catch (...) {
+    /* describing needs memory; without it there is only the name */
+    return std::invalid_argument::what();
+  }
+  return m_description->text.c_str();
+}
+
+build_result::build_result(parser_tables_ptr tables_arg)
+  :m_tables(tables_arg)
+{
+}
+
+build_result::build_result(build_failure_ptr failure_arg)
+  :m_failure(failure_arg)
+{
+}
+
+parser_tables_ptr const& build_result::tables_or_throw() const {
+  if (!m_tables) throw build_error(m_failure);
+  return m_tables;
+}
+
+}  // namespace parsegen
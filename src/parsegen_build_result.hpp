@@ -0,0 +1,93 @@
+#ifndef PARSEGEN_BUILD_RESULT_HPP
+#define PARSEGEN_BUILD_RESULT_HPP
+
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "parsegen_parser_tables.hpp"
+
+namespace parsegen {
+
+/* two actions of one parser state that claim the same lookahead
+   terminal. `first` is always a reduction, `second` is the shift
+   or the other reduction it collides with */
+struct lalr1_conflict {
+  int state;
+  int terminal;
+  action first;
+  action second;
+};
+
+/* why a language could not be turned into parser tables.
+   only indices are recorded when the failure is detected;
+   the human-readable text is produced by describe() on demand */
+class build_failure {
+ public:
+  enum class kind {
+    invalid_language,
+    ambiguous_grammar,
+    not_lalr1
+  };
+ private:
+  build_failure::kind m_kind;
+  std::string m_message;
+  grammar_ptr m_grammar;
+  int m_state;
+  std::vector<lalr1_conflict> m_conflicts;
+ public:
+  build_failure(build_failure::kind kind_arg, std::string const& message_arg);
+  build_failure(build_failure::kind kind_arg, grammar_ptr grammar_arg,
+      int state_arg, std::vector<lalr1_conflict>&& conflicts_arg = {});
+  build_failure::kind get_kind() const { return m_kind; }
+  grammar_ptr const& get_grammar() const { return m_grammar; }
+  /* the state in which the grammar was found to be ambiguous,
+     or -1 if not applicable */
+  int get_state() const { return m_state; }
+  std::vector<lalr1_conflict> const& get_conflicts() const { return m_conflicts; }
+  std::string describe() const;
+};
+
+/* the functions that take a build_failure_ptr& report an unusable
+   language by setting it, rather than by throwing build_error,
+   so that try_build_parser_tables gets the failure as a value */
+using build_failure_ptr = std::shared_ptr<build_failure const>;
+
+/* thrown by build_parser_tables and the functions it calls
+   when a language is unusable. what() is the failure's describe(),
+   rendered the first time it is asked for; the copies of the
+   exception share that text, which is made only once even if
+   several threads ask for it at the same time */
+class build_error : public std::invalid_argument {
+  struct description {
+    std::once_flag once;
+    std::string text;
+  };
+  build_failure_ptr m_failure;
+  std::shared_ptr<description> m_description;
+ public:
+  build_error(build_failure&& failure_arg);
+  build_error(build_failure_ptr failure_arg);
+  build_failure_ptr const& failure() const { return m_failure; }
+  char const* what() const noexcept override;
+};
+
+class build_result {
+  parser_tables_ptr m_tables;
+  build_failure_ptr m_failure;
+ public:
+  build_result(parser_tables_ptr tables_arg);
+  build_result(build_failure_ptr failure_arg);
+  explicit operator bool() const { return bool(m_tables); }
+  parser_tables_ptr const& tables() const { return m_tables; }
+  /* nullptr if the build succeeded */
+  build_failure const* failure() const { return m_failure.get(); }
+  /* the tables, or throws the failure as a build_error */
+  parser_tables_ptr const& tables_or_throw() const;
+};
+
+}  // namespace parsegen
+
+#endif
@@ -7,9 +7,14 @@
 
 namespace {
 
-class calculator : public parsegen::parser {
+/* the actions are called statically by basic_parser,
+   so the compiler can inline them into the parsing loop,
+   and reduce_in_place reads the values where they sit on the value stack */
+class calculator : public parsegen::basic_parser<calculator, std::any> {
  public:
-  calculator() : parsegen::parser(parsegen::math_lang::ask_parser_tables()) {
+  calculator()
+    : parsegen::basic_parser<calculator, std::any>(
+        parsegen::math_lang::ask_parser_tables()) {
     unary_function_map["sqrt"] = &std::sqrt;
     unary_function_map["sin"] = &std::sin;
     unary_function_map["cos"] = &std::cos;
@@ -22,15 +27,15 @@ class calculator : public parsegen::parser {
     unary_function_map["log10"] = &std::log10;
     binary_function_map["atan2"] = &std::atan2;
   }
-  virtual ~calculator() = default;
 
- protected:
+ private:
+  friend class parsegen::basic_parser<calculator, std::any>;
   struct arguments {
     double a0;
     double a1;
     int n;
   };
-  virtual std::any shift(int token, std::string& text) override {
+  std::any shift(int token, std::string& text) {
     switch (token) {
       case parsegen::math_lang::TOK_NAME: {
         return text;
@@ -41,15 +46,15 @@ class calculator : public parsegen::parser {
     }
     return std::any();
   }
-  virtual std::any reduce(int prod, std::vector<std::any>& rhs) override {
+  std::any reduce_in_place(int prod, parsegen::span<std::any> rhs) {
     using std::any_cast;
     switch (prod) {
       case parsegen::math_lang::PROD_PROGRAM: {
-        if (!rhs.at(1).has_value()) {
+        if (!rhs[1].has_value()) {
           throw parsegen::error(
               "Calculator needs an expression to evaluate!");
         }
-        return std::move(rhs.at(1));
+        return std::move(rhs[1]);
       }
       case parsegen::math_lang::PROD_NO_STATEMENTS:
       case parsegen::math_lang::PROD_NO_EXPR:
@@ -57,8 +62,8 @@ class calculator : public parsegen::parser {
         return std::any();
       }
       case parsegen::math_lang::PROD_ASSIGN: {
-        auto& name = any_cast<std::string&>(rhs.at(0));
-        double value = any_cast<double>(rhs.at(2));
+        auto& name = any_cast<std::string&>(rhs[0]);
+        double value = any_cast<double>(rhs[2]);
         variable_map[name] = value;
         return value;
       }
@@ -72,40 +77,40 @@ class calculator : public parsegen::parser {
       case parsegen::math_lang::PROD_POW_DECAY:
       case parsegen::math_lang::PROD_NEG_DECAY:
       case parsegen::math_lang::PROD_SOME_ARGS:
-        return std::move(rhs.at(0));
+        return std::move(rhs[0]);
       case parsegen::math_lang::PROD_TERNARY:
-        return any_cast<bool>(rhs.at(0)) ? any_cast<double>(rhs.at(2))
-                                         : any_cast<double>(rhs.at(4));
+        return any_cast<bool>(rhs[0]) ? any_cast<double>(rhs[2])
+                                         : any_cast<double>(rhs[4]);
       case parsegen::math_lang::PROD_OR:
-        return any_cast<bool>(rhs.at(0)) || any_cast<bool>(rhs.at(2));
+        return any_cast<bool>(rhs[0]) || any_cast<bool>(rhs[2]);
       case parsegen::math_lang::PROD_AND:
-        return any_cast<bool>(rhs.at(0)) && any_cast<bool>(rhs.at(2));
+        return any_cast<bool>(rhs[0]) && any_cast<bool>(rhs[2]);
       case parsegen::math_lang::PROD_GT:
-        return any_cast<double>(rhs.at(0)) > any_cast<double>(rhs.at(2));
+        return any_cast<double>(rhs[0]) > any_cast<double>(rhs[2]);
       case parsegen::math_lang::PROD_LT:
-        return any_cast<double>(rhs.at(0)) < any_cast<double>(rhs.at(2));
+        return any_cast<double>(rhs[0]) < any_cast<double>(rhs[2]);
       case parsegen::math_lang::PROD_GEQ:
-        return any_cast<double>(rhs.at(0)) >= any_cast<double>(rhs.at(2));
+        return any_cast<double>(rhs[0]) >= any_cast<double>(rhs[2]);
       case parsegen::math_lang::PROD_LEQ:
-        return any_cast<double>(rhs.at(0)) <= any_cast<double>(rhs.at(2));
+        return any_cast<double>(rhs[0]) <= any_cast<double>(rhs[2]);
       case parsegen::math_lang::PROD_EQ:
-        return any_cast<double>(rhs.at(0)) == any_cast<double>(rhs.at(2));
+        return any_cast<double>(rhs[0]) == any_cast<double>(rhs[2]);
       case parsegen::math_lang::PROD_BOOL_PARENS:
-        return any_cast<bool>(rhs.at(1));
+        return any_cast<bool>(rhs[1]);
       case parsegen::math_lang::PROD_ADD:
-        return any_cast<double>(rhs.at(0)) + any_cast<double>(rhs.at(2));
+        return any_cast<double>(rhs[0]) + any_cast<double>(rhs[2]);
       case parsegen::math_lang::PROD_SUB:
-        return any_cast<double>(rhs.at(0)) - any_cast<double>(rhs.at(2));
+        return any_cast<double>(rhs[0]) - any_cast<double>(rhs[2]);
       case parsegen::math_lang::PROD_MUL:
-        return any_cast<double>(rhs.at(0)) * any_cast<double>(rhs.at(2));
+        return any_cast<double>(rhs[0]) * any_cast<double>(rhs[2]);
       case parsegen::math_lang::PROD_DIV:
-        return any_cast<double>(rhs.at(0)) / any_cast<double>(rhs.at(2));
+        return any_cast<double>(rhs[0]) / any_cast<double>(rhs[2]);
       case parsegen::math_lang::PROD_POW:
         return std::pow(
-            any_cast<double>(rhs.at(0)), any_cast<double>(rhs.at(2)));
+            any_cast<double>(rhs[0]), any_cast<double>(rhs[2]));
       case parsegen::math_lang::PROD_CALL: {
-        auto& name = any_cast<std::string&>(rhs.at(0));
-        auto& args = any_cast<arguments&>(rhs.at(2));
+        auto& name = any_cast<std::string&>(rhs[0]);
+        auto& args = any_cast<arguments&>(rhs[2]);
         if (args.n < 1 || args.n > 2) {
           throw parsegen::error(
               "Only unary and binary functions supported!\n");
@@ -135,24 +140,24 @@ class calculator : public parsegen::parser {
       }
       case parsegen::math_lang::PROD_FIRST_ARG: {
         arguments args;
-        args.a0 = any_cast<double>(rhs.at(0));
+        args.a0 = any_cast<double>(rhs[0]);
         args.n = 1;
         return args;
       }
       case parsegen::math_lang::PROD_NEXT_ARG: {
-        auto& args = any_cast<arguments&>(rhs.at(0));
-        args.a1 = any_cast<double>(rhs.at(2));
+        auto& args = any_cast<arguments&>(rhs[0]);
+        args.a1 = any_cast<double>(rhs[2]);
         args.n += 1;
         return args;
       }
       case parsegen::math_lang::PROD_NEG:
-        return -any_cast<double>(rhs.at(1));
+        return -any_cast<double>(rhs[1]);
       case parsegen::math_lang::PROD_VAL_PARENS:
-        return any_cast<double>(rhs.at(1));
+        return any_cast<double>(rhs[1]);
       case parsegen::math_lang::PROD_CONST:
-        return any_cast<double>(rhs.at(0));
+        return any_cast<double>(rhs[0]);
       case parsegen::math_lang::PROD_VAR:
-        auto& name = any_cast<std::string&>(rhs.at(0));
+        auto& name = any_cast<std::string&>(rhs[0]);
         auto it = variable_map.find(name);
         if (it == variable_map.end()) {
           std::stringstream ss;
@@ -164,7 +169,6 @@ class calculator : public parsegen::parser {
     return std::any();
   }
 
- private:
   typedef double (*Unary)(double);
   typedef double (*Binary)(double, double);
   std::map<std::string, Unary> unary_function_map;
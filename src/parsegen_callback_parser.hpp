@@ -0,0 +1,120 @@
+#ifndef PARSEGEN_CALLBACK_PARSER_HPP
+#define PARSEGEN_CALLBACK_PARSER_HPP
+
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "parsegen_basic_parser.hpp"
+
+namespace parsegen {
+
+/* A parser whose semantic actions are registered one callable per
+   production (and per token) instead of being written as a switch
+   inside a reduce() override.
+   The callables are kept in flat arrays indexed by production and
+   token number, so dispatch is a single indexed call.
+   Productions and tokens without a registered callable produce
+   a default-constructed Value, and productions registered as
+   pass-through skip the call and the copy into reduction_rhs entirely.
+   Reduce callbacks see the right hand side values in place on the
+   value stack and may move from them. */
+template <class Value>
+class callback_parser : public basic_parser<callback_parser<Value>, Value> {
+  using base_type = basic_parser<callback_parser<Value>, Value>;
+
+ public:
+  using shift_callback = std::function<Value(std::string&)>;
+  using reduce_callback = std::function<Value(span<Value>)>;
+  callback_parser(parser_tables_ptr tables_in);
+  callback_parser(callback_parser const&) = default;
+  void on_shift(int token, shift_callback callback);
+  void on_reduce(int production, reduce_callback callback);
+  /* the value of the production is the value of its rhs_index-th
+     right hand side symbol */
+  void pass_through(int production, int rhs_index);
+
+ private:
+  friend base_type;
+  Value shift(int token, std::string& text);
+  Value reduce_in_place(int production, span<Value> rhs);
+  int pass_through(int production) const {
+    return at(pass_through_indices, production);
+  }
+  void check_production(int production) const;
+  std::vector<shift_callback> shift_callbacks;
+  std::vector<reduce_callback> reduce_callbacks;
+  std::vector<int> pass_through_indices;
+};
+
+template <class Value>
+callback_parser<Value>::callback_parser(parser_tables_ptr tables_in)
+    : base_type(tables_in),
+      shift_callbacks(std::size_t(this->grammar->nterminals)),
+      reduce_callbacks(this->grammar->productions.size()),
+      pass_through_indices(this->grammar->productions.size(), -1)
+{
+}
+
+template <class Value>
+void callback_parser<Value>::on_shift(int token, shift_callback callback) {
+  if (token < 0 || token >= isize(shift_callbacks)) {
+    throw std::invalid_argument(
+        "callback_parser::on_shift: token " + std::to_string(token) +
+        " is out of range");
+  }
+  at(shift_callbacks, token) = std::move(callback);
+}
+
+template <class Value>
+void callback_parser<Value>::check_production(int production) const {
+  /* the last production is the accept production added by
+     build_grammar, which is never reduced */
+  if (production < 0 || production + 1 >= isize(reduce_callbacks)) {
+    throw std::invalid_argument(
+        "callback_parser: production " + std::to_string(production) +
+        " is out of range");
+  }
+}
+
+template <class Value>
+void callback_parser<Value>::on_reduce(
+    int production, reduce_callback callback) {
+  check_production(production);
+  at(reduce_callbacks, production) = std::move(callback);
+  at(pass_through_indices, production) = -1;
+}
+
+template <class Value>
+void callback_parser<Value>::pass_through(int production, int rhs_index) {
+  check_production(production);
+  auto const nrhs = isize(at(this->grammar->productions, production).rhs);
+  if (rhs_index < 0 || rhs_index >= nrhs) {
+    throw std::invalid_argument(
+        "callback_parser::pass_through: production " +
+        std::to_string(production) + " has no right hand side symbol " +
+        std::to_string(rhs_index));
+  }
+  at(reduce_callbacks, production) = nullptr;
+  at(pass_through_indices, production) = rhs_index;
+}
+
+template <class Value>
+Value callback_parser<Value>::shift(int token, std::string& text) {
+  auto& callback = at(shift_callbacks, token);
+  if (!callback) return Value();
+  return callback(text);
+}
+
+template <class Value>
+Value callback_parser<Value>::reduce_in_place(
+    int production, span<Value> rhs) {
+  auto& callback = at(reduce_callbacks, production);
+  if (!callback) return Value();
+  return callback(rhs);
+}
+
+}  // namespace parsegen
+
+#endif
@@ -28,6 +28,8 @@ class error : public std::runtime_error {
   {
     m_full_message = m_before_message + m_parser_message + m_after_message;
   }
+  std::string const& before_message() const { return m_before_message; }
+  std::string const& after_message() const { return m_after_message; }
   void set_before_message(std::string const& before_message_arg)
   {
     m_before_message = before_message_arg;
@@ -113,6 +113,13 @@ void negate_acceptance(finite_automaton& fa) {
   }
 }
 
+void relabel_acceptance(finite_automaton& fa, int token) {
+  assert(0 <= token);
+  for (auto& accepted : fa.accepted_tokens) {
+    if (accepted != -1) accepted = token;
+  }
+}
+
 finite_automaton add_death_state(finite_automaton const& a) {
   finite_automaton out(get_nsymbols(a), false, get_nstates(a) + 1);
   append_states(out, a);
@@ -58,6 +58,7 @@ int accepts(finite_automaton const& fa, int state);
 int get_nsymbols_eps(finite_automaton const& fa);
 void append_states(finite_automaton& fa, finite_automaton const& other);
 void negate_acceptance(finite_automaton& fa);
+void relabel_acceptance(finite_automaton& fa, int token);
 finite_automaton add_death_state(finite_automaton const& a);
 finite_automaton remove_transitions_from_accepting(finite_automaton const& a);
 
@@ -3,6 +3,7 @@
 #include <iostream>
 #include <set>
 
+#include "parsegen_build_result.hpp"
 #include "parsegen_std_vector.hpp"
 
 namespace parsegen {
@@ -24,6 +25,13 @@ int as_nonterminal(grammar const& g, int symbol) {
 }
 
 int find_goal_symbol(grammar const& g) {
+  build_failure_ptr failure;
+  auto const goal_symbol = find_goal_symbol(g, failure);
+  if (failure) throw build_error(failure);
+  return goal_symbol;
+}
+
+int find_goal_symbol(grammar const& g, build_failure_ptr& failure) {
   std::set<int> nonterminals_in_rhss;
   for (auto& p : g.productions) {
     for (auto s : p.rhs) {
@@ -35,16 +43,19 @@ int find_goal_symbol(grammar const& g) {
   for (int s = g.nterminals; s < g.nsymbols; ++s)
     if (!nonterminals_in_rhss.count(s)) {
       if (result != -1) {
-        std::cerr << "ERROR: there is more than one root nonterminal (";
-        std::cerr << at(g.symbol_names, result) << " and "
-                  << at(g.symbol_names, s) << ") in this grammar\n";
-        abort();
+        failure = std::make_shared<build_failure const>(
+            build_failure::kind::invalid_language,
+            "ERROR: there is more than one root nonterminal (" +
+            at(g.symbol_names, result) + " and " +
+            at(g.symbol_names, s) + ") in this grammar\n");
+        return -1;
       }
       result = s;
     }
   if (result == -1) {
-    std::cerr << "ERROR: the root nonterminal is unclear for this grammar\n";
-    abort();
+    failure = std::make_shared<build_failure const>(
+        build_failure::kind::invalid_language,
+        "ERROR: the root nonterminal is unclear for this grammar\n");
   }
   return result;
 }
@@ -64,7 +75,14 @@ void add_end_terminal(grammar& g) {
 int get_end_terminal(grammar const& g) { return g.nterminals - 1; }
 
 void add_accept_production(grammar& g) {
-  auto goal_symbol = find_goal_symbol(g);
+  build_failure_ptr failure;
+  add_accept_production(g, failure);
+  if (failure) throw build_error(failure);
+}
+
+void add_accept_production(grammar& g, build_failure_ptr& failure) {
+  auto goal_symbol = find_goal_symbol(g, failure);
+  if (failure) return;
   grammar::production p;
   p.lhs = g.nsymbols;
   p.rhs = {goal_symbol};
@@ -77,6 +95,8 @@ int get_accept_production(grammar const& g) { return isize(g.productions) - 1; }
 
 int get_accept_nonterminal(grammar const& g) { return g.nsymbols - 1; }
 
+int get_error_terminal(grammar const& g) { return g.error_terminal; }
+
 std::ostream& operator<<(std::ostream& os, grammar const& g) {
   os << "symbols:\n";
   for (int i = 0; i < isize(g.symbol_names); ++i) {
@@ -22,20 +22,32 @@ struct grammar {
   production_vector productions;
   std::vector<std::string> symbol_names;
   std::vector<int> ignored_terminals;
+  /* the "error" pseudo-terminal used for error recovery,
+     which the lexer never produces, or -1 if the language
+     doesn't use it */
+  int error_terminal = -1;
 };
 
 using grammar_ptr = std::shared_ptr<grammar const>;
 
+class build_failure;
+
 int get_nnonterminals(grammar const& g);
 bool is_terminal(grammar const& g, int symbol);
 bool is_nonterminal(grammar const& g, int symbol);
 int as_nonterminal(grammar const& g, int symbol);
 int find_goal_symbol(grammar const& g);
+/* returns -1 and sets failure if there isn't exactly one goal symbol */
+int find_goal_symbol(
+    grammar const& g, std::shared_ptr<build_failure const>& failure);
 void add_end_terminal(grammar& g);
 int get_end_terminal(grammar const& g);
 void add_accept_production(grammar& g);
+void add_accept_production(
+    grammar& g, std::shared_ptr<build_failure const>& failure);
 int get_accept_production(grammar const& g);
 int get_accept_nonterminal(grammar const& g);
+int get_error_terminal(grammar const& g);
 
 std::ostream& operator<<(std::ostream& os, grammar const& g);
 
@@ -0,0 +1,92 @@
+#include "parsegen_incremental_build.hpp"
+
+#include "parsegen_build_parser.hpp"
+#include "parsegen_std_vector.hpp"
+
+namespace parsegen {
+
+static bool operator==(language::token const& a, language::token const& b) {
+  return a.name == b.name && a.regex == b.regex;
+}
+
+static bool operator==(
+    language::production const& a, language::production const& b) {
+  return a.lhs == b.lhs && a.rhs == b.rhs;
+}
+
+/* the DFAs are cached with token 0 and relabeled on the way out,
+   so one regex used by different token indices is built only once */
+finite_automaton const& incremental_builder::ask_token_dfa(
+    language const& language, int token) {
+  auto& regex = at(language.tokens, token).regex;
+  auto it = token_dfas.find(regex);
+  if (it == token_dfas.end()) {
+    auto dfa = build_token_dfa(language, token);
+    relabel_acceptance(dfa, 0);
+    it = token_dfas.emplace(regex, std::move(dfa)).first;
+  }
+  return it->second;
+}
+
+bool incremental_builder::lexer_is_current(language const& language) const {
+  return has_lexer && lexer_tokens == language.tokens;
+}
+
+bool incremental_builder::grammar_is_current(language const& language) const {
+  if (!has_syntax_tables) return false;
+  if (grammar_tokens.size() != language.tokens.size()) return false;
+  for (int i = 0; i < isize(grammar_tokens); ++i) {
+    if (at(grammar_tokens, i) != at(language.tokens, i).name) return false;
+  }
+  return grammar_ignored_tokens == language.ignored_tokens &&
+         grammar_productions == language.productions;
+}
+
+parser_tables_ptr incremental_builder::build(language const& language) {
+  /* a cached DFA was built for the regex, not for this token,
+     so each token is checked as build_token_dfa checks it */
+  for (int i = 0; i < isize(language.tokens); ++i) {
+    if (auto failure = check_token(language, i)) throw build_error(failure);
+  }
+  auto indent_info = build_indent_info(language);
+  if (!lexer_is_current(language)) {
+    std::vector<finite_automaton> dfas;
+    reserve(dfas, isize(language.tokens));
+    for (int i = 0; i < isize(language.tokens); ++i) {
+      dfas.push_back(ask_token_dfa(language, i));
+      relabel_acceptance(dfas.back(), i);
+    }
+    lexer = build_lexer(dfas);
+    lexer_tokens = language.tokens;
+    has_lexer = true;
+  }
+  if (!grammar_is_current(language)) {
+    auto grammar = build_grammar(language);
+    syntax_tables = accept_parser(build_lalr1_parser(grammar));
+    grammar_tokens.clear();
+    for (auto& token : language.tokens) grammar_tokens.push_back(token.name);
+    grammar_ignored_tokens = language.ignored_tokens;
+    grammar_productions = language.productions;
+    has_syntax_tables = true;
+  }
+  return parser_tables_ptr(
+      new parser_tables({syntax_tables, lexer, indent_info}));
+}
+
+void incremental_builder::clear() {
+  token_dfas.clear();
+  lexer_tokens.clear();
+  lexer = finite_automaton();
+  has_lexer = false;
+  grammar_tokens.clear();
+  grammar_ignored_tokens.clear();
+  grammar_productions.clear();
+  syntax_tables = shift_reduce_tables();
+  has_syntax_tables = false;
+}
+
+int incremental_builder::get_ncached_token_dfas() const {
+  return int(token_dfas.size());
+}
+
+}  // namespace parsegen
@@ -0,0 +1,48 @@
+#ifndef PARSEGEN_INCREMENTAL_BUILD_HPP
+#define PARSEGEN_INCREMENTAL_BUILD_HPP
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "parsegen_language.hpp"
+
+namespace parsegen {
+
+/* builds parser_tables for a language that is edited and rebuilt
+   repeatedly, for example by a grammar authoring tool.
+   The cost of a rebuild is kept proportional to what changed:
+
+   - the DFA for each token is cached by its regex string,
+     so only new or edited regexes are parsed and determinized
+   - the lexer is reused as-is if no token changed
+   - the LALR(1) tables are reused as-is if neither the productions,
+     the token names nor the ignored tokens changed,
+     so editing a regex never rebuilds the shift-reduce tables
+
+   The cache lives as long as the builder. */
+class incremental_builder {
+ public:
+  parser_tables_ptr build(language const& language);
+  void clear();
+  int get_ncached_token_dfas() const;
+
+ private:
+  finite_automaton const& ask_token_dfa(language const& language, int token);
+  bool lexer_is_current(language const& language) const;
+  bool grammar_is_current(language const& language) const;
+
+  std::map<std::string, finite_automaton> token_dfas;
+  std::vector<language::token> lexer_tokens;
+  finite_automaton lexer;
+  bool has_lexer = false;
+  std::vector<std::string> grammar_tokens;
+  std::vector<std::string> grammar_ignored_tokens;
+  std::vector<language::production> grammar_productions;
+  shift_reduce_tables syntax_tables;
+  bool has_syntax_tables = false;
+};
+
+}  // namespace parsegen
+
+#endif
@@ -9,23 +9,53 @@
 #include "parsegen_regex.hpp"
 #include "parsegen_std_vector.hpp"
 #include "parsegen_string.hpp"
+#include "parsegen_table_cache.hpp"
 #include "parsegen_error.hpp"
 
 namespace parsegen {
 
 grammar_ptr build_grammar(language const& language) {
+  build_failure_ptr failure;
+  auto grammar = build_grammar(language, failure);
+  if (failure) throw build_error(failure);
+  return grammar;
+}
+
+grammar_ptr build_grammar(language const& language, build_failure_ptr& failure) {
   std::map<std::string, int> symbol_map;
   int nterminals = 0;
   for (auto& token : language.tokens) {
     symbol_map[token.name] = nterminals++;
   }
+  /* yacc-style error recovery: productions may mention an "error"
+     symbol that isn't one of the tokens, which becomes a terminal
+     the lexer never produces */
+  int error_terminal = -1;
+  if (!symbol_map.count(error_symbol_name)) {
+    for (auto& production : language.productions) {
+      for (auto& symbol : production.rhs) {
+        if (symbol == error_symbol_name) error_terminal = nterminals;
+      }
+    }
+    if (error_terminal != -1) symbol_map[error_symbol_name] = nterminals++;
+  }
   int nsymbols = nterminals;
   for (auto& production : language.productions) {
     if (production.lhs.empty()) {
-      std::cerr << "ERROR: production "
+      std::stringstream ss;
+      ss << "ERROR: production "
         << (&production - language.productions.data())
         << " has empty left hand side\n";
-      abort();
+      failure = std::make_shared<build_failure const>(
+          build_failure::kind::invalid_language, ss.str());
+      return nullptr;
+    }
+    if (production.lhs == error_symbol_name && error_terminal != -1) {
+      failure = std::make_shared<build_failure const>(
+          build_failure::kind::invalid_language,
+          "ERROR: the \"error\" symbol is reserved for error recovery "
+          "and can't be the left hand side of a production\n");
+      return nullptr;
     }
     if (symbol_map.count(production.lhs)) continue;
     symbol_map[production.lhs] = nsymbols++;
@@ -33,6 +63,7 @@ grammar_ptr build_grammar(language const& language) {
   grammar out;
   out.nsymbols = nsymbols;
   out.nterminals = nterminals;
+  out.error_terminal = error_terminal;
   for (auto& lang_prod : language.productions) {
     grammar::production gprod;
     assert(symbol_map.count(lang_prod.lhs));
@@ -43,7 +74,9 @@ grammar_ptr build_grammar(language const& language) {
         ss << "RHS entry \"" << lang_symb
            << "\" is neither a nonterminal (LHS of a production) nor a "
               "token!\n";
-        throw std::invalid_argument(ss.str());
+        failure = std::make_shared<build_failure const>(
+            build_failure::kind::invalid_language, ss.str());
+        return nullptr;
       }
       gprod.rhs.push_back(symbol_map[lang_symb]);
     }
@@ -54,11 +87,15 @@ grammar_ptr build_grammar(language const& language) {
     at(out.symbol_names, pair.second) = pair.first;
   }
   add_end_terminal(out);
-  add_accept_production(out);
+  add_accept_production(out, failure);
+  if (failure) return nullptr;
   for (auto const& name : language.ignored_tokens) {
     auto const it = symbol_map.find(name);
-    if (it == symbol_map.end()) {
-      throw std::runtime_error("ignored token " + name + " does not exist");
+    if (it == symbol_map.end() || it->second >= out.nterminals) {
+      failure = std::make_shared<build_failure const>(
+          build_failure::kind::invalid_language,
+          "ERROR: ignored token \"" + name + "\" is not a token\n");
+      return nullptr;
     }
     out.ignored_terminals.push_back(it->second);
   }
@@ -103,32 +140,66 @@ std::ostream& operator<<(std::ostream& os, language const& lang) {
   return os;
 }
 
-finite_automaton build_lexer(language const& language) {
+build_failure_ptr check_token(language const& language, int token) {
+  auto& name = at(language.tokens, token).name;
+  auto& regex = at(language.tokens, token).regex;
+  if (name.empty()) {
+    return std::make_shared<build_failure const>(
+        build_failure::kind::invalid_language,
+        "ERROR: token " + std::to_string(token) + " has empty name\n");
+  }
+  if (regex.empty()) {
+    return std::make_shared<build_failure const>(
+        build_failure::kind::invalid_language,
+        "ERROR: token " + std::to_string(token) + " has empty regex\n");
+  }
+  return nullptr;
+}
+
+finite_automaton build_token_dfa(language const& language, int token) {
+  if (auto failure = check_token(language, token)) throw build_error(failure);
+  auto& name = at(language.tokens, token).name;
+  auto& regex = at(language.tokens, token).regex;
+  return regex::build_dfa(name, regex, token);
+}
+
+finite_automaton build_lexer(
+    std::vector<finite_automaton> const& token_dfas, build_profile* profile) {
   finite_automaton lexer;
-  for (int i = 0; i < isize(language.tokens); ++i) {
-    auto& name = at(language.tokens, i).name;
-    auto& regex = at(language.tokens, i).regex;
-    if (name.empty()) {
-      std::cerr << "ERROR: token "
-        << i << " has empty name\n";
-      abort();
-    }
-    if (regex.empty()) {
-      std::cerr << "ERROR: token "
-        << i << " has empty regex\n";
-      abort();
-    }
+  phase_timer union_timer(profile, "nfa_union");
+  for (int i = 0; i < isize(token_dfas); ++i) {
     if (i == 0) {
-      lexer = regex::build_dfa(name, regex, i);
+      lexer = at(token_dfas, i);
     } else {
-      lexer = finite_automaton::unite(lexer, regex::build_dfa(name, regex, i));
+      lexer = finite_automaton::unite(lexer, at(token_dfas, i));
     }
   }
-  lexer = finite_automaton::simplify(finite_automaton::make_deterministic(lexer));
+  union_timer.stop();
+  if (profile) profile->nfa_states = get_nstates(lexer);
+  phase_timer determinization_timer(profile, "determinization");
+  lexer = finite_automaton::make_deterministic(lexer);
+  determinization_timer.stop();
+  if (profile) profile->dfa_states = get_nstates(lexer);
+  phase_timer minimization_timer(profile, "minimization");
+  lexer = finite_automaton::simplify(lexer);
+  minimization_timer.stop();
+  if (profile) profile->minimized_dfa_states = get_nstates(lexer);
   return lexer;
 }
 
-static indentation build_indent_info(language const& language) {
+finite_automaton build_lexer(language const& language, build_profile* profile) {
+  std::vector<finite_automaton> token_dfas;
+  reserve(token_dfas, isize(language.tokens));
+  phase_timer regex_timer(profile, "regex");
+  for (int i = 0; i < isize(language.tokens); ++i) {
+    token_dfas.push_back(build_token_dfa(language, i));
+    if (profile) profile->token_dfa_states += get_nstates(token_dfas.back());
+  }
+  regex_timer.stop();
+  return build_lexer(token_dfas, profile);
+}
+
+indentation build_indent_info(language const& language) {
   indentation out;
   out.is_sensitive = false;
   out.indent_token = -1;
@@ -175,11 +246,66 @@ static indentation build_indent_info(language const& language) {
 }
 
 parser_tables_ptr build_parser_tables(language const& language) {
-  auto lexer = build_lexer(language);
+  char const* cache_dir = std::getenv("PARSEGEN_CACHE_DIR");
+  if (cache_dir != nullptr && cache_dir[0] != '\0') {
+    return build_parser_tables_cached(language, cache_dir);
+  }
+  return build_parser_tables_uncached(language);
+}
+
+build_result try_build_parser_tables(language const& language) {
+  /* the failures found by the builder come back as values; only
+     the checks of build_indent_info and of the regex syntax,
+     which are not build_failures, are thrown */
+  try {
+    char const* cache_dir = std::getenv("PARSEGEN_CACHE_DIR");
+    if (cache_dir != nullptr && cache_dir[0] != '\0') {
+      return try_build_parser_tables_cached(language, cache_dir);
+    }
+    return try_build_parser_tables_uncached(language);
+  } catch (std::invalid_argument const& e) {
+    return build_result(std::make_shared<build_failure const>(
+        build_failure::kind::invalid_language, e.what()));
+  } catch (parsegen::error const& e) {
+    /* a token regex that the regex parser rejects */
+    return build_result(std::make_shared<build_failure const>(
+        build_failure::kind::invalid_language, e.what()));
+  }
+}
+
+parser_tables_ptr build_parser_tables(
+    language const& language, build_profile& profile) {
+  return build_parser_tables_uncached(language, &profile);
+}
+
+parser_tables_ptr build_parser_tables_uncached(
+    language const& language, build_profile* profile) {
+  return try_build_parser_tables_uncached(language, profile).tables_or_throw();
+}
+
+build_result try_build_parser_tables_uncached(
+    language const& language, build_profile* profile) {
+  if (profile) {
+    profile->ntokens = isize(language.tokens);
+    profile->nproductions = isize(language.productions);
+  }
+  for (int i = 0; i < isize(language.tokens); ++i) {
+    if (auto failure = check_token(language, i)) return build_result(failure);
+  }
+  auto lexer = build_lexer(language, profile);
   auto indent_info = build_indent_info(language);
-  auto grammar = build_grammar(language);
-  auto parser = accept_parser(build_lalr1_parser(grammar));
-  return parser_tables_ptr(new parser_tables({parser, lexer, indent_info}));
+  build_failure_ptr failure;
+  phase_timer grammar_timer(profile, "grammar");
+  auto grammar = build_grammar(language, failure);
+  grammar_timer.stop();
+  if (failure) return build_result(failure);
+  auto pip = build_lalr1_parser(grammar, failure, false, profile);
+  if (failure) return build_result(failure);
+  phase_timer table_timer(profile, "table_filling");
+  auto parser = accept_parser(pip);
+  table_timer.stop();
+  return build_result(
+      parser_tables_ptr(new parser_tables({parser, lexer, indent_info})));
 }
 
 }  // namespace parsegen
@@ -6,6 +6,8 @@
 #include <string>
 #include <vector>
 
+#include "parsegen_build_profile.hpp"
+#include "parsegen_build_result.hpp"
 #include "parsegen_finite_automaton.hpp"
 #include "parsegen_grammar.hpp"
 #include "parsegen_parser_tables.hpp"
@@ -28,12 +30,50 @@ struct language {
 
 using language_ptr = std::shared_ptr<language>;
 
+/* a production may use this symbol, which must not be declared
+   as a token, to mark where the parser resumes after a syntax
+   error (see basic_parser) */
+constexpr char const* error_symbol_name = "error";
+
 grammar_ptr build_grammar(language const& language);
+/* returns nullptr and sets failure if the productions are unusable */
+grammar_ptr build_grammar(language const& language, build_failure_ptr& failure);
+
+/* why the token can't be made into a DFA, e.g. an empty name,
+   or nullptr if it can. the syntax of its regex is only checked
+   when the DFA is built */
+build_failure_ptr check_token(language const& language, int token);
+
+finite_automaton build_token_dfa(language const& language, int token);
+
+finite_automaton build_lexer(std::vector<finite_automaton> const& token_dfas,
+    build_profile* profile = nullptr);
+
+finite_automaton build_lexer(
+    language const& language, build_profile* profile = nullptr);
 
-finite_automaton build_lexer(language const& language);
+indentation build_indent_info(language const& language);
 
+/* uses the on-disk cache in $PARSEGEN_CACHE_DIR if that is set,
+   see parsegen_table_cache.hpp */
 parser_tables_ptr build_parser_tables(language const& language);
 
+/* always builds, recording per-phase timings and sizes in the profile */
+parser_tables_ptr build_parser_tables(
+    language const& language, build_profile& profile);
+
+parser_tables_ptr build_parser_tables_uncached(
+    language const& language, build_profile* profile = nullptr);
+
+build_result try_build_parser_tables_uncached(
+    language const& language, build_profile* profile = nullptr);
+
+/* like build_parser_tables, but an unusable language is reported
+   through the result instead of by throwing. the build_failure
+   is handed back as a value, so failing costs no exception and
+   no text; the text is made by describe() when asked for */
+build_result try_build_parser_tables(language const& language);
+
 std::ostream& operator<<(std::ostream& os, language const& lang);
 
 }  // namespace parsegen
@@ -1,5 +1,5 @@
 #include "parsegen_math_lang.hpp"
-#include "parsegen_parser.hpp"
+#include "parsegen_callback_parser.hpp"
 #include "parsegen_regex.hpp"
 
 namespace parsegen {
@@ -82,13 +82,11 @@ language_ptr ask_language() {
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wexit-time-destructors"
 #endif
-  static language_ptr ptr;
+  // initialized once, even when first asked from several threads
+  static language_ptr const ptr(new language(build_language()));
 #ifdef __clang__
 #pragma clang diagnostic pop
 #endif
-  if (ptr.use_count() == 0) {
-    ptr.reset(new language(build_language()));
-  }
   return ptr;
 }
 
@@ -97,57 +95,75 @@ parser_tables_ptr ask_parser_tables() {
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wexit-time-destructors"
 #endif
-  static parser_tables_ptr ptr;
+  static parser_tables_ptr const ptr = build_parser_tables(*ask_language());
 #ifdef __clang__
 #pragma clang diagnostic pop
 #endif
-  if (ptr.use_count() == 0) {
-    language_ptr lang = ask_language();
-    ptr = build_parser_tables(*lang);
-  }
   return ptr;
 }
 
-class symbols_parser : public parser {
+namespace {
+
+class symbols_parser : public callback_parser<std::any> {
  public:
   symbols_parser();
-  ~symbols_parser() override = default;
+  // the callbacks refer to this object's sets
+  symbols_parser(symbols_parser const&) = delete;
 
  public:
   std::set<std::string> variable_names;
   std::set<std::string> function_names;
-
- private:
-  std::any shift(int token, std::string& text) override;
-  std::any reduce(int prod, std::vector<std::any>& rhs) override;
+  /* the text of each name shifted so far in this parse; names are
+     passed up the stack by index so they don't allocate in std::any,
+     and the strings are reused from parse to parse */
+  std::vector<std::string> names;
+  int nnames = 0;
 };
 
-symbols_parser::symbols_parser() : parser(ask_parser_tables()) {}
-
-std::any symbols_parser::shift(int token, std::string& text) {
-  if (token == TOK_NAME) return text;
-  return std::any();
+symbols_parser::symbols_parser()
+    : callback_parser<std::any>(ask_parser_tables()) {
+  on_shift(TOK_NAME, [this](std::string& text) {
+    if (nnames == isize(names)) names.emplace_back();
+    at(names, nnames).assign(text);
+    return std::any(nnames++);
+  });
+  on_reduce(PROD_VAR, [this](span<std::any> rhs) {
+    variable_names.insert(at(names, std::any_cast<int>(at(rhs, 0))));
+    return std::any();
+  });
+  on_reduce(PROD_CALL, [this](span<std::any> rhs) {
+    function_names.insert(at(names, std::any_cast<int>(at(rhs, 0))));
+    return std::any();
+  });
 }
 
-std::any symbols_parser::reduce(int prod, std::vector<std::any>& rhs) {
-  if (prod == PROD_VAR) {
-    auto& name = std::any_cast<std::string&>(rhs.at(0));
-    variable_names.insert(name);
-  } else if (prod == PROD_CALL) {
-    auto& name = std::any_cast<std::string&>(rhs.at(0));
-    function_names.insert(name);
-  }
-  return std::any();
+/* one parser per thread, reused across calls so that
+   steady-state parsing doesn't allocate parser memory */
+symbols_parser& ask_symbols_parser() {
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wexit-time-destructors"
+#endif
+  thread_local symbols_parser parser;
+#ifdef __clang__
+#pragma clang diagnostic pop
+#endif
+  parser.variable_names.clear();
+  parser.function_names.clear();
+  parser.nnames = 0;
+  return parser;
 }
 
+}  // anonymous namespace
+
 std::set<std::string> get_variables_used(std::string const& expr) {
-  symbols_parser parser;
+  auto& parser = ask_symbols_parser();
   parser.parse_string(expr, "get_variables_used");
-  return parser.variable_names;
+  return std::move(parser.variable_names);
 }
 
 std::set<std::string> get_symbols_used(std::string const& expr) {
-  symbols_parser parser;
+  auto& parser = ask_symbols_parser();
   parser.parse_string(expr, "get_symbols_used");
   auto set = std::move(parser.variable_names);
   set.insert(parser.function_names.begin(), parser.function_names.end());
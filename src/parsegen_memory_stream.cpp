@@ -0,0 +1,49 @@
+#include "parsegen_memory_stream.hpp"
+
+namespace parsegen {
+
+memory_streambuf::memory_streambuf(std::string_view text) { reset(text); }
+
+void memory_streambuf::reset(std::string_view text) {
+  /* the get area is never written through */
+  auto const first = const_cast<char*>(text.data());
+  setg(first, first, first + text.size());
+}
+
+memory_streambuf::pos_type memory_streambuf::seekoff(
+    off_type offset,
+    std::ios_base::seekdir direction,
+    std::ios_base::openmode which) {
+  if (!(which & std::ios_base::in)) return pos_type(off_type(-1));
+  off_type base;
+  if (direction == std::ios_base::beg) {
+    base = 0;
+  } else if (direction == std::ios_base::cur) {
+    base = gptr() - eback();
+  } else {
+    base = egptr() - eback();
+  }
+  auto const target = base + offset;
+  if (target < 0 || target > egptr() - eback()) {
+    return pos_type(off_type(-1));
+  }
+  setg(eback(), eback() + target, egptr());
+  return pos_type(target);
+}
+
+memory_streambuf::pos_type memory_streambuf::seekpos(
+    pos_type position, std::ios_base::openmode which) {
+  return seekoff(off_type(position), std::ios_base::beg, which);
+}
+
+memory_istream::memory_istream(std::string_view text)
+    : std::istream(nullptr), m_buffer(text) {
+  rdbuf(&m_buffer);
+}
+
+void memory_istream::reset(std::string_view text) {
+  m_buffer.reset(text);
+  clear();
+}
+
+}  // namespace parsegen
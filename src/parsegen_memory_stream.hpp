@@ -0,0 +1,37 @@
+#ifndef PARSEGEN_MEMORY_STREAM_HPP
+#define PARSEGEN_MEMORY_STREAM_HPP
+
+#include <istream>
+#include <streambuf>
+#include <string_view>
+
+namespace parsegen {
+
+/* a read-only, seekable stream buffer over characters owned by
+   someone else, so parsing a string doesn't first copy it
+   the way std::istringstream does */
+class memory_streambuf : public std::streambuf {
+ public:
+  memory_streambuf(std::string_view text);
+  void reset(std::string_view text);
+
+ protected:
+  pos_type seekoff(
+      off_type offset,
+      std::ios_base::seekdir direction,
+      std::ios_base::openmode which) override;
+  pos_type seekpos(pos_type position, std::ios_base::openmode which) override;
+};
+
+class memory_istream : public std::istream {
+  memory_streambuf m_buffer;
+
+ public:
+  memory_istream(std::string_view text);
+  /* points the stream at new text and clears its state */
+  void reset(std::string_view text);
+};
+
+}  // namespace parsegen
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef PARSEGEN_PARSE_RESULT_HPP
+#define PARSEGEN_PARSE_RESULT_HPP
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+
+namespace parsegen {
+
+/* A compact record of why an input was rejected.
+   It holds only what the driver knew at the point of failure;
+   the human-readable message, which needs to re-read the input
+   to find lines and columns, is rendered on request by
+   parser_base::describe. */
+struct parse_failure {
+  enum class kind : std::uint8_t {
+    none,
+    bad_character,
+    tokenization_failure,
+    unacceptable_token,
+    indent_mismatch,
+    stream_too_long,
+    /* a semantic action threw an exception */
+    action_error
+  };
+  parsegen::parse_failure::kind kind = parsegen::parse_failure::kind::none;
+  /* the lexer token being processed, or -1 if there was none */
+  int token = -1;
+  /* the automaton state on top of the stack */
+  int state = 0;
+  /* the offending text, as byte offsets from the start of the input */
+  std::uint32_t first = 0;
+  std::uint32_t last = 0;
+};
+
+/* the outcome of parsing one input when failures are reported
+   as values rather than thrown: either the value the parser
+   produced or the record of why the input was rejected */
+template <class Value>
+class parse_result {
+  std::optional<Value> m_value;
+  parse_failure m_failure;
+  std::string m_action_message;
+  parse_result() = default;
+ public:
+  static parse_result from_value(Value&& value_arg) {
+    parse_result result;
+    result.m_value.emplace(std::move(value_arg));
+    return result;
+  }
+  static parse_result from_failure(
+      parse_failure const& failure_arg, std::string action_message_arg = "") {
+    parse_result result;
+    result.m_failure = failure_arg;
+    result.m_action_message = std::move(action_message_arg);
+    return result;
+  }
+  explicit operator bool() const { return m_value.has_value(); }
+  bool has_value() const { return m_value.has_value(); }
+  Value& value() { return *m_value; }
+  Value const& value() const { return *m_value; }
+  /* failure().kind is none if the parse succeeded */
+  parse_failure const& failure() const { return m_failure; }
+  /* the message of the exception thrown by a semantic action,
+     for failures of kind action_error; for a parsegen::error this
+     leaves out the location, which describe() renders */
+  std::string const& action_message() const { return m_action_message; }
+};
+
+}  // namespace parsegen
+
+#endif
@@ -7,7 +7,9 @@
 #include <set>
 #include <sstream>
 #include <algorithm>
+#include <stdexcept>
 
+#include "parsegen_memory_stream.hpp"
 #include "parsegen_string.hpp"
 #include "parsegen_error.hpp"
 
@@ -107,26 +109,18 @@ void get_underlined_portion(
   }
 }
 
-void parser::handle_unacceptable_token(std::istream& stream)
-{
-  std::stringstream ss;
-  int line, column;
-  get_line_column(stream, stream_ends_stack.back(), line, column);
-  ss << "at line " << line << " of " << stream_name << ":\n";
-  get_underlined_portion(stream, stream_ends_stack.back(), last_lexer_accept_position, ss);
-  throw unacceptable_token(ss.str(), at(grammar->symbol_names, lexer_token));
-}
-
-void parser::handle_reduce_exception(
+void parser_base::handle_reduce_exception(
     std::istream& stream,
     error& e,
     grammar::production const& prod)
 {
   std::stringstream ss;
-  auto const first_stack_index = isize(symbol_stack) - isize(prod.rhs);
-  auto const last_stack_index = isize(symbol_stack);
-  auto const first_stream_pos = at(stream_ends_stack, first_stack_index);
-  auto const last_stream_pos = at(stream_ends_stack, last_stack_index);
+  /* the right hand side starts where the frame below it ends */
+  auto const first_frame = isize(frames) - 1 - isize(prod.rhs);
+  failure = make_failure(parse_failure::kind::action_error,
+      at(frames, first_frame).end, frames.back().end);
+  auto const first_stream_pos = get_stream_position(failure.first);
+  auto const last_stream_pos = get_stream_position(failure.last);
   int line, column;
   get_line_column(stream, first_stream_pos, line, column);
   ss << "\nat line " << line << " of " << stream_name << ":\n";
@@ -135,180 +129,199 @@ void parser::handle_reduce_exception(
   throw;
 }
 
-void parser::handle_shift_exception(std::istream& stream, error& e)
+void parser_base::handle_shift_exception(std::istream& stream, error& e)
 {
   std::stringstream ss;
   int line, column;
-  get_line_column(stream, stream_ends_stack.back(), line, column);
+  failure = make_failure(parse_failure::kind::action_error,
+      frames.back().end, last_lexer_accept_position);
+  auto const first = get_stream_position(failure.first);
+  auto const last = get_stream_position(failure.last);
+  get_line_column(stream, first, line, column);
   ss << "at line " << line << " of " << stream_name << ":\n";
-  get_underlined_portion(stream, stream_ends_stack.back(), last_lexer_accept_position, ss);
+  get_underlined_portion(stream, first, last, ss);
   e.set_parser_message(ss.str());
   throw;
 }
 
-void parser::handle_bad_character(std::istream& stream, char c)
-{
-  std::stringstream ss;
-  int line, column;
-  get_line_column(stream, position, line, column);
-  ss << "at line " << line << ", column " << column << " of " << stream_name << ".\n";
-  throw bad_character(ss.str());
+void parser_base::backtrack_to_last_accept(std::istream& stream) {
+  /* all the last_accept and backtracking is driven by
+    the "accept the longest match" rule */
+  lexer_text.resize(last_lexer_accept);
+  stream.seekg(get_stream_position(last_lexer_accept_position));
+  position = last_lexer_accept_position;
 }
 
-void parser::at_token(std::istream& stream) {
-  bool done = false;
-  /* this can loop arbitrarily as reductions are made,
-     because they don't consume the token */
-  while (!done) {
-    auto parser_action = get_action(syntax_tables, parser_state, lexer_token);
-    if (parser_action.kind == action::kind::none) {
-      handle_unacceptable_token(stream);
-    } else if (parser_action.kind == action::kind::shift) {
-      std::any shift_result;
-      try {
-        shift_result = this->shift(lexer_token, lexer_text);
-      } catch (error& e) {
-        handle_shift_exception(stream, e);
-      }
-      value_stack.emplace_back(std::move(shift_result));
-      stream_ends_stack.push_back(last_lexer_accept_position);
-      symbol_stack.push_back(lexer_token);
-      done = true;
-    } else if (parser_action.kind == action::kind::reduce) {
-      if (parser_action.production == get_accept_production(*grammar)) {
-        did_accept = true;
-        return;
-      }
-      auto& prod = at(grammar->productions, parser_action.production);
-      reduction_rhs.clear();
-      for (int i = 0; i < isize(prod.rhs); ++i) {
-        reduction_rhs.emplace_back(
-            std::move(at(value_stack, isize(value_stack) - isize(prod.rhs) + i)));
-      }
-      std::any reduce_result;
-      try {
-        reduce_result =
-            this->reduce(parser_action.production, reduction_rhs);
-      } catch (error& e) {
-        handle_reduce_exception(stream, e, prod);
-      }
-      resize(value_stack, isize(value_stack) - isize(prod.rhs));
-      value_stack.emplace_back(std::move(reduce_result));
-      auto const old_end = stream_ends_stack.back();
-      resize(stream_ends_stack, isize(stream_ends_stack) - isize(prod.rhs));
-      stream_ends_stack.push_back(old_end);
-      resize(symbol_stack, isize(symbol_stack) - isize(prod.rhs));
-      symbol_stack.push_back(prod.lhs);
-    } else if (parser_action.kind == action::kind::skip) {
-      stream_ends_stack.back() = last_lexer_accept_position;
-      done = true;
-    } else {
-      throw std::logic_error(
-          "serious bug in parsegen::parser: action::kind enum value out of range\n");
-    }
-    parser_state = execute_action(syntax_tables, parser_stack, parser_action);
-  }
+void parser_base::save_state(automaton_state& out) const {
+  out.position = position;
+  out.furthest_position = furthest_position;
+  out.frames = frames;
+  out.sensing_indent = sensing_indent;
+  out.indent_text = indent_text;
+  out.indent_stack = indent_stack;
+  out.recovery_countdown = recovery_countdown;
+  out.diagnostics = diagnostics;
 }
 
-void parser::handle_indent_mismatch(std::istream& stream) {
-  std::stringstream ss;
-  int line, column;
-  get_line_column(stream, last_lexer_accept_position, line, column);
-  ss << "The indentation characters beginning line " << line << " of "
-     << stream_name << " do not match earlier indentation.\n";
-  throw error("", "", ss.str());
+void parser_base::restore_state(automaton_state const& in) {
+  reset_lexer_state();
+  last_lexer_accept = 0;
+  position = in.position;
+  last_lexer_accept_position = in.position;
+  furthest_position = in.furthest_position;
+  frames = in.frames;
+  sensing_indent = in.sensing_indent;
+  indent_text = in.indent_text;
+  indent_stack = in.indent_stack;
+  recovery_countdown = in.recovery_countdown;
+  diagnostics = in.diagnostics;
+  failure = parse_failure();
+  did_accept = false;
 }
 
-void parser::at_token_indent(std::istream& stream) {
-  if (!sensing_indent || lexer_token != tables->indent_info.newline_token) {
-    at_token(stream);
-    return;
+void parser_base::check_state(automaton_state const& in, int nvalues) const {
+  auto const nstates = get_nstates(syntax_tables);
+  auto const nsymbols = isize(grammar->symbol_names);
+  bool ok = !in.frames.empty() && isize(in.frames) == nvalues + 1 &&
+            in.frames.front().symbol == -1 &&
+            in.furthest_position >= in.position;
+  for (auto& frame : in.frames) {
+    if (!ok) break;
+    ok = 0 <= frame.state && frame.state < nstates &&
+         -1 <= frame.symbol && frame.symbol < nsymbols && frame.end <= in.position;
   }
-  auto last_newline_pos = lexer_text.find_last_of("\n");
-  if (last_newline_pos == std::string::npos) {
-    throw error("", "", "INDENT token did not contain a newline");
+  for (auto& entry : in.indent_stack) {
+    if (!ok) break;
+    ok = entry.start_length <= entry.end_length &&
+         entry.end_length <= in.indent_text.size();
   }
-  auto lexer_indent =
-      lexer_text.substr(last_newline_pos + 1, std::string::npos);
-  // the at_token call is allowed to do anything to lexer_text
-  at_token(stream);
-  lexer_text.clear();
-  std::size_t minlen = std::min(lexer_indent.length(), indent_text.length());
-  if (lexer_indent.length() > indent_text.length()) {
-    if (0 != lexer_indent.compare(0, indent_text.length(), indent_text)) {
-      handle_indent_mismatch(stream);
-    }
-    indent_stack.push_back({indent_text.length(), lexer_indent.length()});
-    indent_text = lexer_indent;
-    lexer_token = tables->indent_info.indent_token;
-    at_token(stream);
-  } else if (lexer_indent.length() < indent_text.length()) {
-    if (0 != indent_text.compare(0, lexer_indent.length(), lexer_indent)) {
-      handle_indent_mismatch(stream);
-    }
-    while (!indent_stack.empty()) {
-      auto top = indent_stack.back();
-      if (top.end_length <= minlen) break;
-      indent_stack.pop_back();
-      lexer_token = tables->indent_info.dedent_token;
-      at_token(stream);
-    }
-    indent_text = lexer_indent;
-  } else {
-    if (0 != lexer_indent.compare(indent_text)) {
-      handle_indent_mismatch(stream);
-    }
+  if (!ok) {
+    throw std::invalid_argument(
+        "parsegen::parser: the snapshot was not taken by a parser "
+        "using these tables");
   }
 }
 
-void parser::backtrack_to_last_accept(std::istream& stream) {
-  /* all the last_accept and backtracking is driven by
-    the "accept the longest match" rule */
-  lexer_text.resize(last_lexer_accept);
-  stream.seekg(last_lexer_accept_position);
-}
-
-void parser::reset_lexer_state() {
+void parser_base::reset_lexer_state() {
   lexer_state = 0;
   lexer_text.clear();
   lexer_token = -1;
 }
 
-void parser::print_parser_stack(std::istream& stream, std::ostream& output)
+void parser_base::print_parser_stack(std::istream& stream, std::ostream& output)
 {
   output << "The parser stack contains:\n";
-  for (int i = 0; i < isize(symbol_stack); ++i) {
-    output << at(grammar->symbol_names, at(symbol_stack, i)) << ":\n";
-    if (i + 1 >= isize(stream_ends_stack)) {
-      throw std::logic_error("i + 1 >= isize(stream_ends_stack)!");
-    }
-    auto const first = at(stream_ends_stack, i);
-    auto const last = at(stream_ends_stack, i + 1);
+  for (int i = 1; i < isize(frames); ++i) {
+    output << at(grammar->symbol_names, at(frames, i).symbol) << ":\n";
+    auto const first = get_stream_position(at(frames, i - 1).end);
+    auto const last = get_stream_position(at(frames, i).end);
     get_underlined_portion(stream, first, last, output);
     output << '\n';
   }
 }
 
-void parser::handle_tokenization_failure(std::istream& stream)
+parse_failure parser_base::make_failure(
+    decltype(parse_failure::kind) kind_value,
+    std::uint32_t first,
+    std::uint32_t last) const {
+  parse_failure out;
+  out.kind = kind_value;
+  out.token = lexer_token;
+  out.state = frames.back().state;
+  out.first = first;
+  out.last = last;
+  return out;
+}
+
+bool parser_base::fail(
+    decltype(parse_failure::kind) kind_value, std::uint32_t first, std::uint32_t last) {
+  failure = make_failure(kind_value, first, last);
+  return false;
+}
+
+std::string parser_base::describe(
+    parse_failure const& failure_in,
+    std::istream& stream,
+    stream_position start,
+    std::string_view name) const
 {
   std::stringstream ss;
   int line, column;
-  get_line_column(stream, last_lexer_accept_position, line, column);
-  ss << "at line " << line << " of " << stream_name << ":\n";
-  get_underlined_portion(stream, last_lexer_accept_position, position, ss);
-  throw tokenization_failure(ss.str());
+  auto const first = start + std::streamoff(failure_in.first);
+  auto const last = start + std::streamoff(failure_in.last);
+  switch (failure_in.kind) {
+    case parse_failure::kind::none:
+      break;
+    case parse_failure::kind::bad_character:
+      get_line_column(stream, first, line, column);
+      ss << "at line " << line << ", column " << column << " of " << name << ".\n";
+      break;
+    case parse_failure::kind::tokenization_failure:
+    case parse_failure::kind::unacceptable_token:
+    case parse_failure::kind::action_error:
+      get_line_column(stream, first, line, column);
+      ss << "at line " << line << " of " << name << ":\n";
+      get_underlined_portion(stream, first, last, ss);
+      break;
+    case parse_failure::kind::indent_mismatch:
+      get_line_column(stream, first, line, column);
+      ss << "The indentation characters beginning line " << line << " of "
+         << name << " do not match earlier indentation.\n";
+      break;
+    case parse_failure::kind::stream_too_long:
+      ss << "The stream " << name << " is too long for parsegen::parser, "
+            "which supports streams of up to 4 GiB\n";
+      break;
+  }
+  return ss.str();
+}
+
+std::string parser_base::describe(
+    parse_failure const& failure_in,
+    std::string_view text,
+    std::string_view name) const
+{
+  memory_istream stream(text);
+  return describe(failure_in, stream, 0, name);
+}
+
+void parser_base::throw_failure(std::istream& stream)
+{
+  throw_described(failure,
+      describe(failure, stream, stream_start, stream_name), "");
+}
+
+void parser_base::throw_failure(
+    parse_failure const& failure_in,
+    std::string_view text,
+    std::string_view name,
+    std::string const& action_message) const
+{
+  throw_described(failure_in, describe(failure_in, text, name), action_message);
 }
 
-void parser::at_lexer_end(std::istream& stream) {
-  if (lexer_token == -1) {
-    handle_tokenization_failure(stream);
+void parser_base::throw_described(
+    parse_failure const& failure_in,
+    std::string const& message,
+    std::string const& action_message) const
+{
+  switch (failure_in.kind) {
+    case parse_failure::kind::bad_character:
+      throw bad_character(message);
+    case parse_failure::kind::tokenization_failure:
+      throw tokenization_failure(message);
+    case parse_failure::kind::unacceptable_token:
+      throw unacceptable_token(message,
+          at(grammar->symbol_names, failure_in.token));
+    case parse_failure::kind::action_error:
+      /* laid out as handle_reduce_exception lays it out */
+      throw error(action_message, "", "\n" + message);
+    default:
+      throw error("", "", message);
   }
-  backtrack_to_last_accept(stream);
-  at_token_indent(stream);
-  reset_lexer_state();
 }
 
-parser::parser(parser_tables_ptr tables_in)
+parser_base::parser_base(parser_tables_ptr tables_in)
     : tables(tables_in),
       syntax_tables(tables->syntax_tables),
       lexical_tables(tables->lexical_tables),
@@ -317,88 +330,67 @@ parser::parser(parser_tables_ptr tables_in)
   if (!get_determinism(lexical_tables)) {
     throw std::logic_error("parsegen::parser: the lexer in the given tables is not a deterministic finite automaton");
   }
+  reserve(frames, 64);
+  reset();
 }
 
-std::any parser::parse_stream(
-    std::istream& stream, std::string const& stream_name_in) {
+void parser_base::reset() {
   lexer_state = 0;
   lexer_text.clear();
   lexer_token = -1;
-  parser_state = 0;
-  parser_stack.clear();
-  parser_stack.push_back(parser_state);
-  value_stack.clear();
-  stream_ends_stack.clear();
-  stream_ends_stack.push_back(stream.tellg());
-  symbol_stack.clear();
+  last_lexer_accept = 0;
+  position = 0;
+  last_lexer_accept_position = 0;
+  furthest_position = 0;
+  frames.clear();
+  frames.push_back({0, -1, 0});
+  failure = parse_failure();
+  diagnostics.clear();
+  recovery_countdown = 0;
   did_accept = false;
-  stream_name = stream_name_in;
-  if (tables->indent_info.is_sensitive) {
-    sensing_indent = true;
-    indent_text.clear();
-    indent_stack.clear();
-  } else {
-    sensing_indent = false;
-  }
-  char c;
-  while (stream.get(c)) {
-    if (!is_symbol(c)) {
-      handle_bad_character(stream, c);
-    }
-    position = stream.tellg();
-    lexer_text.push_back(c);
-    auto lexer_symbol = get_symbol(c);
-    lexer_state = step(lexical_tables, lexer_state, lexer_symbol);
-    if (lexer_state == -1) {
-      at_lexer_end(stream);
-    } else {
-      auto token = accepts(lexical_tables, lexer_state);
-      if (token != -1) {
-        lexer_token = token;
-        last_lexer_accept = lexer_text.size();
-        last_lexer_accept_position = stream.tellg();
-      }
-    }
-  }
-  if (last_lexer_accept < lexer_text.size()) {
-    handle_tokenization_failure(stream);
-  }
-  at_lexer_end(stream);
-  lexer_token = get_end_terminal(*grammar);
-  at_token(stream);
+  sensing_indent = tables->indent_info.is_sensitive;
+  indent_text.clear();
+  indent_stack.clear();
+}
+
+void parser_base::begin_parse(
+    std::istream& stream, std::string_view stream_name_in) {
+  stream_start = stream.tellg();
+  stream_name.assign(stream_name_in);
+}
+
+void parser_base::check_accepted(int value_stack_size) {
   if (!did_accept) {
     throw std::logic_error(
         "The EOF terminal was accepted but the root nonterminal was not "
         "reduced\n"
         "This indicates a bug in parsegen::parser\n");
   }
-  if (value_stack.size() != 1) {
+  if (value_stack_size != 1) {
     throw std::logic_error(
         "parsegen::parser::parse_stream finished but value_stack has size "
-        + std::to_string(value_stack.size())
+        + std::to_string(value_stack_size)
         + "\nThis indicates a bug in parsegen::parser\n");
   }
-  return std::move(value_stack.back());
 }
 
-std::any parser::parse_string(
-    std::string const& string, std::string const& string_name) {
-  std::istringstream stream(string);
-  return parse_stream(stream, string_name);
-}
+template class basic_parser<parser, std::any>;
 
-std::any parser::parse_file(std::filesystem::path const& file_path) {
-  std::ifstream stream(file_path);
-  if (!stream.is_open()) {
-    throw error("", "", "Could not open file " + file_path.string());
-  }
-  return parse_stream(stream, file_path.string());
+parser::parser(parser_tables_ptr tables_in)
+    : basic_parser<parser, std::any>(tables_in)
+{
 }
 
 std::any parser::shift(int, std::string&) { return std::any(); }
 
 std::any parser::reduce(int, std::vector<std::any>&) { return std::any(); }
 
+void parser::begin_input() {}
+
+std::uint32_t parser::action_mark() const { return 0; }
+
+void parser::rewind_actions(std::uint32_t) {}
+
 debug_parser::debug_parser(parser_tables_ptr tables_in, std::ostream& os_in)
     : parser(tables_in), os(os_in) {}
 
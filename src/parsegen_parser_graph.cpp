@@ -6,30 +6,44 @@
 
 namespace parsegen {
 
-parser_graph make_graph_with_nnodes(int nnodes) {
-  return parser_graph(std::size_t(nnodes));
+parser_graph make_graph_from_edges(int nnodes, edge_list const& list) {
+  parser_graph g;
+  g.offsets.assign(std::size_t(nnodes + 1), 0);
+  for (auto& edge : list) ++at(g.offsets, edge.first + 1);
+  for (int i = 0; i < nnodes; ++i) {
+    at(g.offsets, i + 1) += at(g.offsets, i);
+  }
+  resize(g.edges, isize(list));
+  auto next = g.offsets;
+  for (auto& edge : list) {
+    at(g.edges, at(next, edge.first)++) = edge.second;
+  }
+  return g;
 }
 
-int get_nnodes(parser_graph const& g) { return isize(g); }
+int get_nnodes(parser_graph const& g) { return isize(g.offsets) - 1; }
 
-void add_edge(parser_graph& g, int i, int j) { at(g, i).push_back(j); }
+int get_nedges(parser_graph const& g) { return isize(g.edges); }
 
-node_edges const& get_edges(parser_graph const& g, int i) { return at(g, i); }
-
-node_edges& get_edges(parser_graph& g, int i) { return at(g, i); }
+node_edges get_edges(parser_graph const& g, int i) {
+  auto first = at(g.offsets, i);
+  auto last = at(g.offsets, i + 1);
+  return node_edges(g.edges.data() + first, last - first);
+}
 
 parser_graph make_transpose(parser_graph const& g) {
   auto nnodes = get_nnodes(g);
-  auto transpose = make_graph_with_nnodes(nnodes);
+  edge_list list;
+  reserve(list, get_nedges(g));
   for (int i = 0; i < nnodes; ++i) {
     for (auto j : get_edges(g, i)) {
-      add_edge(transpose, j, i);
+      list.push_back({j, i});
     }
   }
-  return transpose;
+  return make_graph_from_edges(nnodes, list);
 }
 
-int at(parser_graph const& g, int i, int j) { return at(at(g, i), j); }
+int at(parser_graph const& g, int i, int j) { return get_edges(g, i)[j]; }
 
 std::ostream& operator<<(std::ostream& os, parser_graph const& g) {
   for (int i = 0; i < get_nnodes(g); ++i) {
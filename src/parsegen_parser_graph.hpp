@@ -2,18 +2,35 @@
 #define PARSEGEN_GRAPH_HPP
 
 #include <iosfwd>
+#include <utility>
 #include <vector>
 
+#include "parsegen_span.hpp"
+
 namespace parsegen {
 
-using node_edges = std::vector<int>;
-using parser_graph = std::vector<node_edges>;
+/* compressed sparse row storage: the edges leaving node i are
+   edges[offsets[i]] through edges[offsets[i + 1] - 1] */
+struct parser_graph {
+  std::vector<int> offsets;
+  std::vector<int> edges;
+  parser_graph() : offsets(1, 0) {}
+};
+
+using node_edges = span<int const>;
+using edge_list = std::vector<std::pair<int, int>>;
 
-parser_graph make_graph_with_nnodes(int nnodes);
+/* edges leaving the same node keep their order in the list */
+parser_graph make_graph_from_edges(int nnodes, edge_list const& list);
+/* nodes are appended in order, each with all of its edges */
+template <typename Iterator>
+void append_node(parser_graph& g, Iterator first, Iterator last) {
+  g.edges.insert(g.edges.end(), first, last);
+  g.offsets.push_back(int(g.edges.size()));
+}
 int get_nnodes(parser_graph const& g);
-void add_edge(parser_graph& g, int i, int j);
-node_edges const& get_edges(parser_graph const& g, int i);
-node_edges& get_edges(parser_graph& g, int i);
+int get_nedges(parser_graph const& g);
+node_edges get_edges(parser_graph const& g, int i);
 parser_graph make_transpose(parser_graph const& g);
 int at(parser_graph const& g, int i, int j);
 std::ostream& operator<<(std::ostream& os, parser_graph const& g);
@@ -0,0 +1,147 @@
+#include "parsegen_parser_snapshot.hpp"
+
+#include <algorithm>
+#include <istream>
+#include <ostream>
+#include <string>
+
+#include "parsegen_error.hpp"
+
+namespace parsegen {
+
+namespace {
+
+enum : std::uint32_t { SNAPSHOT_FORMAT_VERSION = 1 };
+
+char const snapshot_magic[8] = {'P', 'G', 'S', 'N', 'A', 'P', 'S', 'H'};
+
+/* sizes are checked so that a truncated or corrupt file
+   can't trigger a huge allocation */
+constexpr std::uint32_t max_snapshot_size = std::uint32_t(1) << 28;
+
+template <class T>
+void write_raw(std::ostream& stream, T value) {
+  stream.write(reinterpret_cast<char const*>(&value), sizeof(value));
+}
+
+template <class T>
+T read_raw(std::istream& stream) {
+  T value{};
+  stream.read(reinterpret_cast<char*>(&value), sizeof(value));
+  return value;
+}
+
+std::uint32_t read_size(std::istream& stream) {
+  auto n = read_raw<std::uint32_t>(stream);
+  if (n > max_snapshot_size) {
+    stream.setstate(std::ios_base::failbit);
+    return 0;
+  }
+  return n;
+}
+
+void write_string(std::ostream& stream, std::string const& s) {
+  write_raw(stream, std::uint32_t(s.size()));
+  stream.write(s.data(), std::streamsize(s.size()));
+}
+
+std::string read_string(std::istream& stream) {
+  auto n = read_size(stream);
+  std::string s(std::size_t(n), '\0');
+  if (n) stream.read(&s[0], std::streamsize(n));
+  return s;
+}
+
+}  // anonymous namespace
+
+void write_automaton_state(
+    std::ostream& stream, parser_base::automaton_state const& state) {
+  stream.write(snapshot_magic, sizeof(snapshot_magic));
+  write_raw(stream, std::uint32_t(SNAPSHOT_FORMAT_VERSION));
+  write_raw(stream, state.position);
+  write_raw(stream, state.furthest_position);
+  write_raw(stream, std::uint32_t(state.frames.size()));
+  for (auto& frame : state.frames) {
+    write_raw(stream, std::int32_t(frame.state));
+    write_raw(stream, std::int32_t(frame.symbol));
+    write_raw(stream, frame.end);
+  }
+  write_raw(stream, std::uint8_t(state.sensing_indent));
+  write_string(stream, state.indent_text);
+  write_raw(stream, std::uint32_t(state.indent_stack.size()));
+  for (auto& entry : state.indent_stack) {
+    write_raw(stream, std::uint64_t(entry.start_length));
+    write_raw(stream, std::uint64_t(entry.end_length));
+  }
+  write_raw(stream, std::int32_t(state.recovery_countdown));
+  write_raw(stream, std::uint32_t(state.diagnostics.size()));
+  for (auto& diagnostic : state.diagnostics) {
+    write_raw(stream, std::uint8_t(diagnostic.kind));
+    write_raw(stream, std::int32_t(diagnostic.token));
+    write_raw(stream, std::int32_t(diagnostic.state));
+    write_raw(stream, diagnostic.first);
+    write_raw(stream, diagnostic.last);
+  }
+}
+
+bool read_automaton_state(
+    std::istream& stream, parser_base::automaton_state& state) {
+  char magic[sizeof(snapshot_magic)];
+  stream.read(magic, sizeof(magic));
+  if (!stream || !std::equal(magic, magic + sizeof(magic), snapshot_magic)) {
+    return false;
+  }
+  if (read_raw<std::uint32_t>(stream) != SNAPSHOT_FORMAT_VERSION) return false;
+  state.position = read_raw<std::uint32_t>(stream);
+  state.furthest_position = read_raw<std::uint32_t>(stream);
+  auto const nframes = read_size(stream);
+  state.frames.clear();
+  for (std::uint32_t i = 0; i < nframes && stream; ++i) {
+    parser_base::stack_frame frame;
+    frame.state = read_raw<std::int32_t>(stream);
+    frame.symbol = read_raw<std::int32_t>(stream);
+    frame.end = read_raw<std::uint32_t>(stream);
+    state.frames.push_back(frame);
+  }
+  state.sensing_indent = read_raw<std::uint8_t>(stream) != 0;
+  state.indent_text = read_string(stream);
+  auto const nentries = read_size(stream);
+  state.indent_stack.clear();
+  for (std::uint32_t i = 0; i < nentries && stream; ++i) {
+    parser_base::indent_stack_entry entry;
+    entry.start_length = std::size_t(read_raw<std::uint64_t>(stream));
+    entry.end_length = std::size_t(read_raw<std::uint64_t>(stream));
+    state.indent_stack.push_back(entry);
+  }
+  state.recovery_countdown = read_raw<std::int32_t>(stream);
+  auto const ndiagnostics = read_size(stream);
+  state.diagnostics.clear();
+  for (std::uint32_t i = 0; i < ndiagnostics && stream; ++i) {
+    parse_failure diagnostic;
+    auto const kind_value = read_raw<std::uint8_t>(stream);
+    if (kind_value > std::uint8_t(parse_failure::kind::action_error)) {
+      return false;
+    }
+    diagnostic.kind = decltype(parse_failure::kind)(kind_value);
+    diagnostic.token = read_raw<std::int32_t>(stream);
+    diagnostic.state = read_raw<std::int32_t>(stream);
+    diagnostic.first = read_raw<std::uint32_t>(stream);
+    diagnostic.last = read_raw<std::uint32_t>(stream);
+    state.diagnostics.push_back(diagnostic);
+  }
+  return bool(stream);
+}
+
+void write_snapshot_count(std::ostream& stream, std::uint32_t count) {
+  write_raw(stream, count);
+}
+
+std::uint32_t read_snapshot_count(std::istream& stream) {
+  return read_size(stream);
+}
+
+void throw_bad_snapshot() {
+  throw error("", "", "The stream does not hold a parsegen parser snapshot\n");
+}
+
+}  // namespace parsegen
@@ -0,0 +1,66 @@
+#ifndef PARSEGEN_PARSER_SNAPSHOT_HPP
+#define PARSEGEN_PARSER_SNAPSHOT_HPP
+
+#include <cstdint>
+#include <iosfwd>
+#include <utility>
+
+#include "parsegen_basic_parser.hpp"
+
+namespace parsegen {
+
+/* Binary serialization of parser_snapshot, so that a long parse
+   can be resumed by another process (see
+   basic_parser::set_snapshot_handler).
+   The semantic values are written and read by the caller's
+   functions, called once per value in stack order:
+
+     void write_value(std::ostream& stream, Value const& value);
+     Value read_value(std::istream& stream);
+
+   Like the table cache, snapshots use the native byte order and
+   are not meant to be shared between machines, and they can only
+   be restored by a parser built from the same language. */
+
+void write_automaton_state(
+    std::ostream& stream, parser_base::automaton_state const& state);
+
+/* returns false if the stream does not hold a snapshot */
+bool read_automaton_state(
+    std::istream& stream, parser_base::automaton_state& state);
+
+void write_snapshot_count(std::ostream& stream, std::uint32_t count);
+
+std::uint32_t read_snapshot_count(std::istream& stream);
+
+[[noreturn]] void throw_bad_snapshot();
+
+template <class Value, class WriteValue>
+void write_snapshot(
+    std::ostream& stream,
+    parser_snapshot<Value> const& snapshot,
+    WriteValue&& write_value) {
+  write_automaton_state(stream, snapshot.state);
+  write_snapshot_count(stream, std::uint32_t(snapshot.values.size()));
+  for (auto& value : snapshot.values) write_value(stream, value);
+}
+
+/* throws parsegen::error if the stream does not hold a snapshot */
+template <class Value, class ReadValue>
+parser_snapshot<Value> read_snapshot(
+    std::istream& stream, ReadValue&& read_value) {
+  parser_snapshot<Value> out;
+  if (!read_automaton_state(stream, out.state)) throw_bad_snapshot();
+  auto const nvalues = read_snapshot_count(stream);
+  if (nvalues + 1 != out.state.frames.size()) throw_bad_snapshot();
+  reserve(out.values, int(nvalues));
+  for (std::uint32_t i = 0; i < nvalues; ++i) {
+    out.values.push_back(read_value(stream));
+  }
+  if (!stream) throw_bad_snapshot();
+  return out;
+}
+
+}  // namespace parsegen
+
+#endif
@@ -103,11 +103,8 @@ parser_tables_ptr ask_parser_tables() {
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wexit-time-destructors"
 #endif
-  static parser_tables_ptr ptr;
-#ifdef __clang__
-#pragma clang diagnostic pop
-#endif
-  if (ptr.use_count() == 0) {
+  // initialized once, even when first asked from several threads
+  static parser_tables_ptr const ptr = [] {
     auto lang = regex::ask_language();
     auto grammar = build_grammar(*lang);
     auto parser = accept_parser(build_lalr1_parser(grammar));
@@ -116,8 +113,11 @@ parser_tables_ptr ask_parser_tables() {
     indent_info.is_sensitive = false;
     indent_info.indent_token = -1;
     indent_info.dedent_token = -1;
-    ptr.reset(new parser_tables{parser, lexer, indent_info});
-  }
+    return parser_tables_ptr(new parser_tables{parser, lexer, indent_info});
+  }();
+#ifdef __clang__
+#pragma clang diagnostic pop
+#endif
   return ptr;
 }
 
@@ -126,13 +126,10 @@ language_ptr ask_language() {
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wexit-time-destructors"
 #endif
-  static language_ptr ptr;
+  static language_ptr const ptr(new language(build_language()));
 #ifdef __clang__
 #pragma clang diagnostic pop
 #endif
-  if (ptr.use_count() == 0) {
-    ptr.reset(new language(build_language()));
-  }
   return ptr;
 }
 
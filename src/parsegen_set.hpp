@@ -1,7 +1,10 @@
 #ifndef PARSEGEN_SET_HPP
 #define PARSEGEN_SET_HPP
 
+#include <algorithm>
+#include <iterator>
 #include <set>
+#include <vector>
 
 namespace parsegen {
 
@@ -35,6 +38,46 @@ bool intersects(std::set<T>& a, std::set<T> const& b) {
   return false;
 }
 
+/* the same operations on sets stored as sorted vectors */
+
+template <typename T>
+void unite_with(std::vector<T>& a, std::vector<T> const& b) {
+  if (b.empty()) return;
+  std::vector<T> c;
+  c.reserve(a.size() + b.size());
+  std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(c));
+  a.swap(c);
+}
+
+template <typename T>
+void subtract_from(std::vector<T>& a, std::vector<T> const& b) {
+  if (a.empty() || b.empty()) return;
+  auto out = a.begin();
+  auto it = b.begin();
+  for (auto& x : a) {
+    while (it != b.end() && *it < x) ++it;
+    if (it != b.end() && !(x < *it)) continue;
+    *out++ = x;
+  }
+  a.erase(out, a.end());
+}
+
+template <typename Range1, typename Range2>
+bool sorted_intersects(Range1 const& a, Range2 const& b) {
+  auto i = a.begin();
+  auto j = b.begin();
+  while (i != a.end() && j != b.end()) {
+    if (*i < *j) {
+      ++i;
+    } else if (*j < *i) {
+      ++j;
+    } else {
+      return true;
+    }
+  }
+  return false;
+}
+
 }  // namespace parsegen
 
 #endif
@@ -68,6 +68,10 @@ int execute_action(
   return stack.back();
 }
 
+int get_goto(shift_reduce_tables const& p, int state, int symbol) {
+  return at(p.nonterminal_table, state, as_nonterminal(*(p.grammar), symbol));
+}
+
 grammar_ptr const& get_grammar(shift_reduce_tables const& p) { return p.grammar; }
 
 }  // end namespace parsegen
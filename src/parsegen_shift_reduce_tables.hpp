@@ -39,6 +39,9 @@ void add_nonterminal_action(
 action const& get_action(shift_reduce_tables const& p, int state, int terminal);
 int execute_action(
     shift_reduce_tables const& p, std::vector<int>& stack, action const& action);
+/* the state entered after reducing to the nonterminal symbol
+   when the given state is exposed on top of the stack */
+int get_goto(shift_reduce_tables const& p, int state, int symbol);
 grammar_ptr const& get_grammar(shift_reduce_tables const& p);
 
 }  // namespace parsegen
@@ -0,0 +1,62 @@
+#ifndef PARSEGEN_SPAN_HPP
+#define PARSEGEN_SPAN_HPP
+
+#include <cassert>
+#include <type_traits>
+#include <vector>
+
+namespace parsegen {
+
+/* a small stand-in for C++20 std::span:
+   a non-owning view of contiguous objects */
+template <typename T>
+class span {
+  T* m_data;
+  int m_size;
+ public:
+  using element_type = T;
+  using value_type = std::remove_cv_t<T>;
+  using iterator = T*;
+  span() : m_data(nullptr), m_size(0) {}
+  span(T* data_arg, int size_arg) : m_data(data_arg), m_size(size_arg) {
+    assert(0 <= size_arg);
+  }
+  span(T* first, T* last) : m_data(first), m_size(int(last - first)) {
+    assert(first <= last);
+  }
+  span(std::vector<value_type>& v) : m_data(v.data()), m_size(int(v.size())) {}
+  template <typename U = T,
+            typename = std::enable_if_t<std::is_const<U>::value>>
+  span(std::vector<value_type> const& v)
+    : m_data(v.data()), m_size(int(v.size())) {}
+  template <typename U,
+            typename = std::enable_if_t<std::is_same<U const, T>::value>>
+  span(span<U> const& other) : m_data(other.data()), m_size(other.size()) {}
+  T* data() const { return m_data; }
+  int size() const { return m_size; }
+  bool empty() const { return m_size == 0; }
+  T* begin() const { return m_data; }
+  T* end() const { return m_data + m_size; }
+  T& operator[](int i) const {
+    assert(0 <= i);
+    assert(i < m_size);
+    return m_data[i];
+  }
+  T& front() const { return (*this)[0]; }
+  T& back() const { return (*this)[m_size - 1]; }
+  span subspan(int offset, int count) const {
+    assert(0 <= offset);
+    assert(offset + count <= m_size);
+    return span(m_data + offset, count);
+  }
+};
+
+template <typename T>
+int isize(span<T> const& s) { return s.size(); }
+
+template <typename T>
+T& at(span<T> const& s, int i) { return s[i]; }
+
+}  // namespace parsegen
+
+#endif
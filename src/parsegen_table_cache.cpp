@@ -0,0 +1,419 @@
+#include "parsegen_table_cache.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <thread>
+
+#include "parsegen_chartab.hpp"
+#include "parsegen_std_vector.hpp"
+
+namespace parsegen {
+
+namespace {
+
+enum : std::uint32_t { CACHE_FORMAT_VERSION = 3 };
+
+char const cache_magic[8] = {'P', 'G', 'T', 'A', 'B', 'L', 'E', 'S'};
+
+/* names how build_parser_tables_uncached makes the tables, i.e. the
+   parser construction (LALR(1) by lane tracing) and its settings.
+   It is part of the cache key, so it must be changed whenever the
+   builder is changed to make different tables for the same language,
+   and files made by the old builder are then missed. */
+char const builder_config[] = "lalr1 lane-tracing";
+
+/* whether first <= value < end */
+bool in_range(int value, int first, int end) {
+  return first <= value && value < end;
+}
+
+/* the cached tables are read back into the driver's arrays
+   without further checks, so a corrupt file must not get past
+   the readers below: any index they read is checked against the
+   size of what it indexes, and a violation is a miss */
+bool all_in_range(std::vector<int> const& values, int first, int end) {
+  return std::all_of(values.begin(), values.end(),
+      [=](int value) { return in_range(value, first, end); });
+}
+
+/* 64-bit FNV-1a */
+class language_hasher {
+  std::uint64_t m_hash = 14695981039346656037ULL;
+ public:
+  void add(std::uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+      m_hash ^= (value >> (8 * i)) & 0xFF;
+      m_hash *= 1099511628211ULL;
+    }
+  }
+  void add(std::string const& s) {
+    add(std::uint64_t(s.size()));
+    for (char c : s) {
+      m_hash ^= std::uint64_t(static_cast<unsigned char>(c));
+      m_hash *= 1099511628211ULL;
+    }
+  }
+  std::uint64_t get() const { return m_hash; }
+};
+
+class table_writer {
+  std::ostream& m_stream;
+ public:
+  table_writer(std::ostream& stream_in) : m_stream(stream_in) {}
+  void write(std::int32_t value) {
+    m_stream.write(reinterpret_cast<char const*>(&value), sizeof(value));
+  }
+  void write(std::uint64_t value) {
+    m_stream.write(reinterpret_cast<char const*>(&value), sizeof(value));
+  }
+  void write(std::string const& s) {
+    write(std::int32_t(s.size()));
+    m_stream.write(s.data(), std::streamsize(s.size()));
+  }
+  void write(std::vector<int> const& v) {
+    write(std::int32_t(v.size()));
+    for (auto x : v) write(std::int32_t(x));
+  }
+  void write(std::vector<std::string> const& v) {
+    write(std::int32_t(v.size()));
+    for (auto& x : v) write(x);
+  }
+};
+
+class table_reader {
+  std::istream& m_stream;
+ public:
+  table_reader(std::istream& stream_in) : m_stream(stream_in) {}
+  bool ok() const { return bool(m_stream); }
+  std::int32_t read_int() {
+    std::int32_t value = 0;
+    m_stream.read(reinterpret_cast<char*>(&value), sizeof(value));
+    return value;
+  }
+  std::uint64_t read_uint64() {
+    std::uint64_t value = 0;
+    m_stream.read(reinterpret_cast<char*>(&value), sizeof(value));
+    return value;
+  }
+  /* sizes are checked so that a truncated or corrupt file
+     can't trigger a huge allocation */
+  int read_size() {
+    auto n = read_int();
+    if (n < 0 || n > (1 << 28)) {
+      m_stream.setstate(std::ios_base::failbit);
+      return 0;
+    }
+    return n;
+  }
+  std::string read_string() {
+    auto n = read_size();
+    std::string s(std::size_t(n), '\0');
+    if (n) m_stream.read(&s[0], n);
+    return s;
+  }
+  std::vector<int> read_ints() {
+    auto n = read_size();
+    std::vector<int> v;
+    reserve(v, n);
+    for (int i = 0; i < n && ok(); ++i) v.push_back(read_int());
+    return v;
+  }
+  std::vector<std::string> read_strings() {
+    auto n = read_size();
+    std::vector<std::string> v;
+    for (int i = 0; i < n && ok(); ++i) v.push_back(read_string());
+    return v;
+  }
+};
+
+void write_language(table_writer& w, language const& language) {
+  w.write(std::int32_t(language.tokens.size()));
+  for (auto& token : language.tokens) {
+    w.write(token.name);
+    w.write(token.regex);
+  }
+  w.write(language.ignored_tokens);
+  w.write(std::int32_t(language.productions.size()));
+  for (auto& production : language.productions) {
+    w.write(production.lhs);
+    w.write(production.rhs);
+  }
+}
+
+bool read_same_language(table_reader& r, language const& language) {
+  if (r.read_size() != isize(language.tokens)) return false;
+  for (auto& token : language.tokens) {
+    if (r.read_string() != token.name) return false;
+    if (r.read_string() != token.regex) return false;
+  }
+  if (r.read_strings() != language.ignored_tokens) return false;
+  if (r.read_size() != isize(language.productions)) return false;
+  for (auto& production : language.productions) {
+    if (r.read_string() != production.lhs) return false;
+    if (r.read_strings() != production.rhs) return false;
+  }
+  return r.ok();
+}
+
+void write_grammar(table_writer& w, grammar const& g) {
+  w.write(std::int32_t(g.nsymbols));
+  w.write(std::int32_t(g.nterminals));
+  w.write(std::int32_t(g.productions.size()));
+  for (auto& production : g.productions) {
+    w.write(std::int32_t(production.lhs));
+    w.write(production.rhs);
+  }
+  w.write(g.symbol_names);
+  w.write(g.ignored_terminals);
+  w.write(std::int32_t(g.error_terminal));
+}
+
+/* returns nullptr if the grammar is not consistent */
+grammar_ptr read_grammar(table_reader& r) {
+  grammar g;
+  g.nsymbols = r.read_int();
+  g.nterminals = r.read_int();
+  if (!in_range(g.nterminals, 1, g.nsymbols)) return nullptr;
+  auto nproductions = r.read_size();
+  for (int i = 0; i < nproductions && r.ok(); ++i) {
+    grammar::production production;
+    production.lhs = r.read_int();
+    production.rhs = r.read_ints();
+    if (!in_range(production.lhs, g.nterminals, g.nsymbols) ||
+        !all_in_range(production.rhs, 0, g.nsymbols)) {
+      return nullptr;
+    }
+    g.productions.push_back(std::move(production));
+  }
+  g.symbol_names = r.read_strings();
+  g.ignored_terminals = r.read_ints();
+  g.error_terminal = r.read_int();
+  if (!r.ok() || g.productions.empty() ||
+      isize(g.symbol_names) != g.nsymbols ||
+      !all_in_range(g.ignored_terminals, 0, g.nterminals) ||
+      !in_range(g.error_terminal, -1, g.nterminals)) {
+    return nullptr;
+  }
+  return std::make_shared<grammar>(std::move(g));
+}
+
+void write_int_table(table_writer& w, table<int> const& t) {
+  w.write(std::int32_t(t.ncols));
+  w.write(t.data);
+}
+
+bool read_int_table(table_reader& r, table<int>& t) {
+  t.ncols = r.read_int();
+  t.data = r.read_ints();
+  return r.ok() && t.ncols > 0 && isize(t.data) % t.ncols == 0;
+}
+
+void write_syntax_tables(table_writer& w, shift_reduce_tables const& p) {
+  write_grammar(w, *(p.grammar));
+  w.write(std::int32_t(p.terminal_table.ncols));
+  w.write(std::int32_t(p.terminal_table.data.size()));
+  for (auto& a : p.terminal_table.data) {
+    w.write(std::int32_t(a.kind));
+    /* the union is only meaningful for shift and reduce,
+       write zero otherwise so identical tables give identical files */
+    std::int32_t value = 0;
+    if (a.kind == action::kind::shift) value = a.next_state;
+    if (a.kind == action::kind::reduce) value = a.production;
+    w.write(value);
+  }
+  write_int_table(w, p.nonterminal_table);
+}
+
+bool read_syntax_tables(table_reader& r, shift_reduce_tables& p) {
+  p.grammar = read_grammar(r);
+  if (!p.grammar) return false;
+  auto const& g = *(p.grammar);
+  p.terminal_table.ncols = r.read_int();
+  auto nentries = r.read_size();
+  if (p.terminal_table.ncols != g.nterminals ||
+      nentries % g.nterminals != 0) {
+    return false;
+  }
+  auto const nstates = nentries / g.nterminals;
+  auto const nproductions = isize(g.productions);
+  reserve(p.terminal_table.data, nentries);
+  for (int i = 0; i < nentries && r.ok(); ++i) {
+    action a;
+    auto kind_value = r.read_int();
+    auto value = r.read_int();
+    if (kind_value < int(action::kind::none) ||
+        kind_value > int(action::kind::skip)) {
+      return false;
+    }
+    a.kind = static_cast<decltype(a.kind)>(kind_value);
+    if (a.kind == action::kind::shift) {
+      if (!in_range(value, 0, nstates)) return false;
+      a.next_state = value;
+    } else {
+      if (a.kind == action::kind::reduce &&
+          !in_range(value, 0, nproductions)) {
+        return false;
+      }
+      a.production = value;
+    }
+    p.terminal_table.data.push_back(a);
+  }
+  if (!r.ok() || nstates == 0) return false;
+  return read_int_table(r, p.nonterminal_table) &&
+    get_ncols(p.nonterminal_table) == get_nnonterminals(g) &&
+    get_nrows(p.nonterminal_table) == nstates &&
+    all_in_range(p.nonterminal_table.data, -1, nstates);
+}
+
+void write_lexical_tables(table_writer& w, finite_automaton const& fa) {
+  w.write(std::int32_t(fa.is_deterministic));
+  write_int_table(w, fa.table);
+  w.write(fa.accepted_tokens);
+}
+
+bool read_lexical_tables(table_reader& r, finite_automaton& fa,
+    int nterminals) {
+  fa.is_deterministic = (r.read_int() != 0);
+  if (!fa.is_deterministic || !read_int_table(r, fa.table)) return false;
+  fa.accepted_tokens = r.read_ints();
+  auto const nstates = get_nrows(fa.table);
+  return r.ok() && get_ncols(fa.table) == NCHARS &&
+    isize(fa.accepted_tokens) == nstates &&
+    all_in_range(fa.table.data, -1, nstates) &&
+    all_in_range(fa.accepted_tokens, -1, nterminals);
+}
+
+/* the key the tables of this language are cached under,
+   which also covers how the builder is configured */
+std::uint64_t cache_key(language const& language) {
+  language_hasher h;
+  h.add(std::string(builder_config));
+  h.add(hash_language(language));
+  return h.get();
+}
+
+}  // end anonymous namespace
+
+std::uint64_t hash_language(language const& language) {
+  language_hasher h;
+  h.add(std::uint64_t(language.tokens.size()));
+  for (auto& token : language.tokens) {
+    h.add(token.name);
+    h.add(token.regex);
+  }
+  h.add(std::uint64_t(language.ignored_tokens.size()));
+  for (auto& name : language.ignored_tokens) h.add(name);
+  h.add(std::uint64_t(language.productions.size()));
+  for (auto& production : language.productions) {
+    h.add(production.lhs);
+    h.add(std::uint64_t(production.rhs.size()));
+    for (auto& symbol : production.rhs) h.add(symbol);
+  }
+  return h.get();
+}
+
+void write_parser_tables(
+    std::ostream& stream, language const& language, parser_tables const& tables) {
+  table_writer w(stream);
+  stream.write(cache_magic, sizeof(cache_magic));
+  w.write(std::int32_t(CACHE_FORMAT_VERSION));
+  w.write(cache_key(language));
+  w.write(std::string(builder_config));
+  write_language(w, language);
+  write_syntax_tables(w, tables.syntax_tables);
+  write_lexical_tables(w, tables.lexical_tables);
+  auto& indent = tables.indent_info;
+  w.write(std::int32_t(indent.is_sensitive));
+  w.write(std::int32_t(indent.indent_token));
+  w.write(std::int32_t(indent.dedent_token));
+  w.write(std::int32_t(indent.newline_token));
+}
+
+parser_tables_ptr read_parser_tables(
+    std::istream& stream, language const& language) {
+  table_reader r(stream);
+  char magic[sizeof(cache_magic)];
+  stream.read(magic, sizeof(magic));
+  if (!r.ok() || !std::equal(magic, magic + sizeof(magic), cache_magic)) {
+    return nullptr;
+  }
+  if (r.read_int() != std::int32_t(CACHE_FORMAT_VERSION)) return nullptr;
+  if (r.read_uint64() != cache_key(language)) return nullptr;
+  if (r.read_string() != builder_config) return nullptr;
+  if (!read_same_language(r, language)) return nullptr;
+  parser_tables tables;
+  if (!read_syntax_tables(r, tables.syntax_tables)) return nullptr;
+  auto const nterminals = tables.syntax_tables.grammar->nterminals;
+  if (!read_lexical_tables(r, tables.lexical_tables, nterminals)) {
+    return nullptr;
+  }
+  auto& indent = tables.indent_info;
+  indent.is_sensitive = (r.read_int() != 0);
+  indent.indent_token = r.read_int();
+  indent.dedent_token = r.read_int();
+  indent.newline_token = r.read_int();
+  if (!r.ok() || !in_range(indent.indent_token, -1, nterminals) ||
+      !in_range(indent.dedent_token, -1, nterminals) ||
+      !in_range(indent.newline_token, -1, nterminals)) {
+    return nullptr;
+  }
+  return std::make_shared<parser_tables const>(std::move(tables));
+}
+
+std::filesystem::path get_cache_path(
+    std::filesystem::path const& cache_dir, language const& language) {
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx.tables",
+      static_cast<unsigned long long>(cache_key(language)));
+  return cache_dir / name;
+}
+
+parser_tables_ptr build_parser_tables_cached(
+    language const& language, std::filesystem::path const& cache_dir) {
+  return try_build_parser_tables_cached(language, cache_dir).tables_or_throw();
+}
+
+build_result try_build_parser_tables_cached(
+    language const& language, std::filesystem::path const& cache_dir) {
+  auto const path = get_cache_path(cache_dir, language);
+  {
+    std::ifstream file(path, std::ios::binary);
+    if (file.is_open()) {
+      auto tables = read_parser_tables(file, language);
+      if (tables) return build_result(tables);
+    }
+  }
+  auto result = try_build_parser_tables_uncached(language);
+  if (!result) return result;
+  auto const& tables = result.tables();
+  /* a failure to store is not an error, the next run just
+     builds the tables again */
+  std::error_code ec;
+  std::filesystem::create_directories(cache_dir, ec);
+  if (ec) return result;
+  static std::atomic<unsigned> temp_counter(0);
+  std::stringstream temp_name;
+  temp_name << path.filename().string() << ".tmp."
+            << std::hash<std::thread::id>()(std::this_thread::get_id()) << '.'
+            << temp_counter++;
+  auto const temp_path = cache_dir / temp_name.str();
+  {
+    std::ofstream file(temp_path, std::ios::binary);
+    if (!file.is_open()) return result;
+    write_parser_tables(file, language, *tables);
+    if (!file) {
+      file.close();
+      std::filesystem::remove(temp_path, ec);
+      return result;
+    }
+  }
+  std::filesystem::rename(temp_path, path, ec);
+  if (ec) std::filesystem::remove(temp_path, ec);
+  return result;
+}
+
+}  // namespace parsegen
@@ -0,0 +1,48 @@
+#ifndef PARSEGEN_TABLE_CACHE_HPP
+#define PARSEGEN_TABLE_CACHE_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+
+#include "parsegen_language.hpp"
+
+namespace parsegen {
+
+/* A content-addressed on-disk cache of parser_tables.
+   build_parser_tables consults it automatically when the
+   PARSEGEN_CACHE_DIR environment variable names a directory:
+   tables are looked up by a hash of the language and of how the
+   builder is configured, and loaded on a hit, or built and then
+   stored atomically (write + rename) on a miss.
+   Each cache file also records the full language it was built from,
+   so a hash collision is detected and treated as a miss, and the
+   tables read from a file are checked to be consistent, so a
+   corrupt file is a miss as well.
+   Cache files use the native byte order and are not meant to be
+   shared between machines. */
+
+std::uint64_t hash_language(language const& language);
+
+void write_parser_tables(
+    std::ostream& stream, language const& language, parser_tables const& tables);
+
+/* returns nullptr if the stream does not hold consistent tables
+   built from exactly this language */
+parser_tables_ptr read_parser_tables(
+    std::istream& stream, language const& language);
+
+std::filesystem::path get_cache_path(
+    std::filesystem::path const& cache_dir, language const& language);
+
+parser_tables_ptr build_parser_tables_cached(
+    language const& language, std::filesystem::path const& cache_dir);
+
+/* a language that can't be built is reported through the result
+   and is not stored */
+build_result try_build_parser_tables_cached(
+    language const& language, std::filesystem::path const& cache_dir);
+
+}  // namespace parsegen
+
+#endif
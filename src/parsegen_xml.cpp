@@ -136,13 +136,11 @@ language_ptr ask_language() {
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wexit-time-destructors"
 #endif
-  static language_ptr ptr;
+  // initialized once, even when first asked from several threads
+  static language_ptr const ptr(new language(build_language()));
 #ifdef __clang__
 #pragma clang diagnostic pop
 #endif
-  if (ptr.use_count() == 0) {
-    ptr.reset(new language(build_language()));
-  }
   return ptr;
 }
 
@@ -151,14 +149,10 @@ parser_tables_ptr ask_parser_tables() {
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wexit-time-destructors"
 #endif
-  static parser_tables_ptr ptr;
+  static parser_tables_ptr const ptr = build_parser_tables(*ask_language());
 #ifdef __clang__
 #pragma clang diagnostic pop
 #endif
-  if (ptr.use_count() == 0) {
-    auto lang = ask_language();
-    ptr = build_parser_tables(*lang);
-  }
   return ptr;
 }
 
@@ -1,9 +1,18 @@
 #include "parsegen_yaml.hpp"
 
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+
 namespace parsegen {
 namespace yaml {
 
-static void build_productions(std::vector<language::production>& prods) {
+static void build_productions(
+    std::vector<language::production>& prods, lexing mode) {
   prods.resize(NPRODS);
   prods[PROD_DOC] = {"doc", {"top_items"}};
   prods[PROD_DOC2] = {"doc", {"NEWLINE", "top_items"}};
@@ -149,13 +158,45 @@ static void build_productions(std::vector<language::production>& prods) {
   prods[PROD_SPACE_STAR_NEXT] = {"WS*", {"WS*", "WS"}};
   prods[PROD_SPACE_PLUS_FIRST] = {"WS+", {"WS"}};
   prods[PROD_SPACE_PLUS_NEXT] = {"WS+", {"WS+", "WS"}};
+  /* "&name" anchors the value after it and "*name" stands for the value
+     last anchored with that name. An anchor takes the place of a tag
+     before a scalar or flow value, and ends the line of a block value.
+     Anywhere else they are plain scalar or quoted text. */
+  prods[PROD_TAG_ANCHOR] = {"tag?", {"ANCHOR", "WS+"}};
+  prods[PROD_ANCHOR_LINE] = {"anchor_line", {"ANCHOR", "NEWLINE"}};
+  prods[PROD_ANCHOR_LINE_TRAIL] = {
+      "anchor_line", {"ANCHOR", "WS+", "NEWLINE"}};
+  prods[PROD_BMAP_ALIAS] = {
+      "bmap_item", {"scalar", ":", "WS*", "ALIAS", "WS*", "NEWLINE"}};
+  prods[PROD_BMAP_ANCHORED_BVALUE] = {
+      "bmap_item", {"scalar", ":", "WS*", "anchor_line", "bvalue"}};
+  prods[PROD_BSEQ_ALIAS] = {
+      "bseq_item", {"-", "WS+", "ALIAS", "WS*", "NEWLINE"}};
+  prods[PROD_BSEQ_ANCHORED_BMAP] = {"bseq_item",
+      {"-", "WS+", "anchor_line", "INDENT", "bmap_items", "DEDENT"}};
+  prods[PROD_BSEQ_ANCHORED_BSEQ] = {"bseq_item",
+      {"-", "WS+", "anchor_line", "INDENT", "bseq_items", "DEDENT"}};
+  prods[PROD_FMAP_ALIAS] = {
+      "fmap_item", {"scalar", ":", "WS*", "ALIAS", "WS*"}};
+  prods[PROD_FSEQ_ALIAS] = {"fseq_item", {"ALIAS", "WS*"}};
+  prods[PROD_SCALAR_TAIL_ANCHOR] = {"scalar_tail", {"ANCHOR"}};
+  prods[PROD_SCALAR_TAIL_ALIAS] = {"scalar_tail", {"ALIAS"}};
+  prods[PROD_COMMON_ANCHOR] = {"common", {"ANCHOR"}};
+  prods[PROD_COMMON_ALIAS] = {"common", {"ALIAS"}};
+  if (mode != lexing::runs) return;
+  prods.resize(NRUN_PRODS);
+  prods[PROD_SCALAR_DQUOTED_RUN] = {"scalar_quoted", {"DQUOTED", "WS*"}};
+  prods[PROD_SCALAR_SQUOTED_RUN] = {"scalar_quoted", {"SQUOTED", "WS*"}};
+  prods[PROD_SCALAR_TAIL_SQUOTED_RUN] = {"scalar_tail", {"SQUOTED"}};
+  prods[PROD_ANY_DQUOTED_RUN] = {"any", {"DQUOTED"}};
+  prods[PROD_ANY_SQUOTED_RUN] = {"any", {"SQUOTED"}};
 }
 
-language build_language() {
+language build_language(lexing mode) {
   language out;
   auto& prods = out.productions;
   auto& toks = out.tokens;
-  build_productions(prods);
+  build_productions(prods, mode);
   toks.resize(NTOKS);
   toks[TOK_NEWLINE] = {"NEWLINE", "((#[^\r\n]*)?\r?\n[ \t]*)+"};
   toks[TOK_INDENT] = {"INDENT", "((#[^\r\n]*)?\r?\n[ \t]*)+"};
@@ -177,37 +218,61 @@ language build_language() {
   toks[TOK_PERCENT] = {"%", "%"};
   toks[TOK_EXCL] = {"!", "!"};
   toks[TOK_OTHER] = {"OTHERCHAR", "[^ \t:\\.\\-\"'\\\\\\|\\[\\]{}>,%#!\n\r]"};
+  /* a lone "&" or "*" is still an OTHERCHAR */
+  toks[TOK_ANCHOR] = {"ANCHOR", "&[^ \t:\"'\\\\\\[\\]{},#\n\r]+"};
+  toks[TOK_ALIAS] = {"ALIAS", "\\*[^ \t:\"'\\\\\\[\\]{},#\n\r]+"};
+  if (mode == lexing::runs) {
+    toks.resize(NRUN_TOKS);
+    toks[TOK_SPACE].regex = "[ \t]+";
+    /* a run starts with a character that can start a plain scalar
+       and goes on through the dots and dashes inside it, which in
+       every context that allows the first character are just more
+       scalar characters. A run cannot start with "&" or "*", which
+       would make it as long as an ANCHOR or ALIAS and win the tie. */
+    toks[TOK_OTHER].regex =
+        "[^ \t:\\.\\-\"'\\\\\\|\\[\\]{}>,%#!&\\*\n\r]"
+        "[^ \t:\"'\\\\\\|\\[\\]{}>,%#!\n\r]*|[&\\*]";
+    /* whole quoted strings, escapes included; an unclosed quote
+       is still lexed as a single TOK_DQUOT or TOK_SQUOT */
+    toks[TOK_DQUOTED_RUN] = {"DQUOTED", "\"([^\"\\\\\n\r]|\\\\[^\n\r])*\""};
+    toks[TOK_SQUOTED_RUN] = {"SQUOTED", "'([^'\n\r]|'')*'"};
+  }
   return out;
 }
 
-language_ptr ask_language() {
+language_ptr ask_language(lexing mode) {
 #ifdef __clang__
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wexit-time-destructors"
 #endif
-  static language_ptr ptr;
+  // each mode is initialized once, even when first asked from several threads
+  if (mode == lexing::runs) {
+    static language_ptr const runs(new language(build_language(mode)));
+    return runs;
+  }
+  static language_ptr const characters(new language(build_language(mode)));
 #ifdef __clang__
 #pragma clang diagnostic pop
 #endif
-  if (ptr.use_count() == 0) {
-    ptr.reset(new language(build_language()));
-  }
-  return ptr;
+  return characters;
 }
 
-parser_tables_ptr ask_parser_tables() {
+parser_tables_ptr ask_parser_tables(lexing mode) {
 #ifdef __clang__
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wexit-time-destructors"
 #endif
-  static parser_tables_ptr ptr;
+  if (mode == lexing::runs) {
+    static parser_tables_ptr const runs =
+      build_parser_tables(*(yaml::ask_language(mode)));
+    return runs;
+  }
+  static parser_tables_ptr const characters =
+    build_parser_tables(*(yaml::ask_language(mode)));
 #ifdef __clang__
 #pragma clang diagnostic pop
 #endif
-  if (ptr.use_count() == 0) {
-    ptr = build_parser_tables(*(yaml::ask_language()));
-  }
-  return ptr;
+  return characters;
 }
 
 bool object::is_scalar() const
@@ -260,42 +325,251 @@ void scalar::print(std::ostream& s, std::string const&) const
   s << m_value;
 }
 
-void map::insert(item&& item_arg)
+std::uint32_t hash_key(std::string_view key)
 {
-  m_impl.insert(std::move(item_arg));
+  std::uint32_t hash = 2166136261u;
+  for (char c : key) {
+    hash ^= std::uint32_t(static_cast<unsigned char>(c));
+    hash *= 16777619u;
+  }
+  return hash;
 }
 
-bool map::has(
-    std::string const& key) const
+/* plain scalars keep the blanks that follow them */
+static std::string_view trim_blanks(std::string_view text)
 {
-  scalar scalar_key(key);
-  auto it = m_impl.find(scalar_key);
-  if (it == m_impl.end()) {
-    return false;
+  auto const first = text.find_first_not_of(" \t");
+  if (first == std::string_view::npos) return std::string_view();
+  auto const last = text.find_last_not_of(" \t");
+  return text.substr(first, last + 1 - first);
+}
+
+[[noreturn]] static void throw_not_a(char const* what, std::string_view text)
+{
+  throw std::invalid_argument(
+      std::string("yaml::scalar is not ") + what + ": " + std::string(text));
+}
+
+static bool read_int64(std::string_view text, std::int64_t& value)
+{
+  auto first = text.data();
+  auto const last = first + text.size();
+  bool negative = false;
+  if (first != last && (*first == '+' || *first == '-')) {
+    negative = (*first == '-');
+    ++first;
+  }
+  int base = 10;
+  if (last - first > 2 && first[0] == '0' &&
+      (first[1] == 'x' || first[1] == 'o')) {
+    base = (first[1] == 'x') ? 16 : 8;
+    first += 2;
+  }
+  /* the magnitude is read unsigned so that the most
+     negative value can be read as well */
+  std::uint64_t magnitude;
+  auto const result = std::from_chars(first, last, magnitude, base);
+  if (result.ec != std::errc() || result.ptr != last) return false;
+  auto const max = std::uint64_t(std::numeric_limits<std::int64_t>::max());
+  if (negative) {
+    if (magnitude > max + 1) return false;
+    value = (magnitude == max + 1) ? std::numeric_limits<std::int64_t>::min()
+                                   : -std::int64_t(magnitude);
+  } else {
+    if (magnitude > max) return false;
+    value = std::int64_t(magnitude);
+  }
+  return true;
+}
+
+static bool read_double(std::string_view text, double& value)
+{
+  if (text == ".nan" || text == ".NaN" || text == ".NAN") {
+    value = std::numeric_limits<double>::quiet_NaN();
+    return true;
+  }
+  auto first = text.data();
+  auto const last = first + text.size();
+  bool negative = false;
+  if (first != last && (*first == '+' || *first == '-')) {
+    negative = (*first == '-');
+    ++first;
+  }
+  auto const rest = std::string_view(first, std::size_t(last - first));
+  if (rest == ".inf" || rest == ".Inf" || rest == ".INF") {
+    value = std::numeric_limits<double>::infinity();
+  } else {
+    /* from_chars would also take a second sign and
+       the C spellings inf and nan, which YAML does not */
+    if (first == last || !(('0' <= *first && *first <= '9') || *first == '.')) {
+      return false;
+    }
+    auto const result = std::from_chars(first, last, value);
+    if (result.ec != std::errc() || result.ptr != last) {
+      std::int64_t integer;
+      if (!read_int64(text, integer)) return false;
+      value = double(integer);
+      return true;
+    }
+  }
+  if (negative) value = -value;
+  return true;
+}
+
+double to_double(std::string_view text)
+{
+  text = trim_blanks(text);
+  double value;
+  if (!read_double(text, value)) throw_not_a("a number", text);
+  return value;
+}
+
+std::int64_t to_int64(std::string_view text)
+{
+  text = trim_blanks(text);
+  std::int64_t value;
+  if (!read_int64(text, value)) throw_not_a("an integer", text);
+  return value;
+}
+
+bool to_bool(std::string_view text)
+{
+  text = trim_blanks(text);
+  if (text == "true" || text == "True" || text == "TRUE") return true;
+  if (text == "false" || text == "False" || text == "FALSE") return false;
+  throw_not_a("a boolean", text);
+}
+
+double scalar::as_double() const
+{
+  if (m_cached == cached::integer) return double(m_number.integer);
+  if (m_cached != cached::real) {
+    m_number.real = to_double(m_value);
+    m_cached = cached::real;
+  }
+  return m_number.real;
+}
+
+std::int64_t scalar::as_int64() const
+{
+  if (m_cached != cached::integer) {
+    m_number.integer = to_int64(m_value);
+    m_cached = cached::integer;
+  }
+  return m_number.integer;
+}
+
+bool scalar::as_bool() const
+{
+  return to_bool(m_value);
+}
+
+int map::find(std::string_view key, std::uint32_t hash) const
+{
+  if (m_slots.empty()) return -1;
+  auto const mask = m_slots.size() - 1;
+  for (auto i = hash & mask;; i = (i + 1) & mask) {
+    auto const& s = m_slots[i];
+    if (s.position == -1) return -1;
+    if (s.hash == hash && at(m_items, s.position).first.string() == key) {
+      return s.position;
+    }
+  }
+}
+
+/* keeps the table at most half full, so probe sequences stay short */
+void map::grow_slots()
+{
+  std::size_t nslots = 8;
+  while (nslots < 4 * m_items.size()) nslots *= 2;
+  m_slots.assign(nslots, slot{0, -1});
+  auto const mask = nslots - 1;
+  for (int position = 0; position < isize(m_items); ++position) {
+    auto const hash = hash_key(at(m_items, position).first.string());
+    auto i = hash & mask;
+    while (m_slots[i].position != -1) i = (i + 1) & mask;
+    m_slots[i] = slot{hash, position};
+  }
+}
+
+bool map::append(item&& item_arg)
+{
+  std::string_view key = item_arg.first.string();
+  auto const hash = hash_key(key);
+  if (find(key, hash) != -1) return false;
+  auto const position = isize(m_items);
+  m_items.push_back(std::move(item_arg));
+  if (2 * m_items.size() > m_slots.size()) {
+    grow_slots();
+  } else {
+    auto const mask = m_slots.size() - 1;
+    auto i = hash & mask;
+    while (m_slots[i].position != -1) i = (i + 1) & mask;
+    m_slots[i] = slot{hash, position};
   }
   return true;
 }
 
+void map::insert(item&& item_arg)
+{
+  sort_keys();
+  if (!append(std::move(item_arg))) return;
+  auto const position = isize(m_items) - 1;
+  auto const& key = at(m_items, position).first.string();
+  auto const after = std::upper_bound(m_sorted.begin(), m_sorted.end(), key,
+      [this](std::string const& a, int b) {
+        return a < at(m_items, b).first.string();
+      });
+  m_sorted.insert(after, position);
+}
+
+bool map::has(
+    std::string_view key) const
+{
+  return find(key, hash_key(key)) != -1;
+}
+
 object const& map::operator[](
-    std::string const& key) const
+    std::string_view key) const
 {
-  scalar scalar_key(key);
-  auto it = m_impl.find(scalar_key);
-  if (it == m_impl.end()) {
+  auto const position = find(key, hash_key(key));
+  if (position == -1) {
     throw std::invalid_argument(
-        "yaml::map key not found: " + key);
+        "yaml::map key not found: " + std::string(key));
   }
-  return *(it->second);
+  return *(at(m_items, position).second);
+}
+
+object const* map::lookup(std::string_view key, std::uint32_t hash) const
+{
+  auto const position = find(key, hash);
+  if (position == -1) return nullptr;
+  return at(m_items, position).second.get();
+}
+
+/* sorts the items appended since the last call and
+   merges them into the ones that were sorted then */
+void map::sort_keys()
+{
+  auto const nsorted = m_sorted.size();
+  if (nsorted == m_items.size()) return;
+  for (auto i = isize(m_sorted); i < isize(m_items); ++i) m_sorted.push_back(i);
+  auto const by_key = [this](int a, int b) {
+    return at(m_items, a).first.string() < at(m_items, b).first.string();
+  };
+  auto const first_new = m_sorted.begin() + std::ptrdiff_t(nsorted);
+  std::sort(first_new, m_sorted.end(), by_key);
+  std::inplace_merge(m_sorted.begin(), first_new, m_sorted.end(), by_key);
 }
 
 map::const_iterator map::begin() const
 {
-  return m_impl.begin();
+  return const_iterator(m_items, m_sorted.data());
 }
 
 map::const_iterator map::end() const
 {
-  return m_impl.end();
+  return const_iterator(m_items, m_sorted.data() + m_sorted.size());
 }
 
 void map::print(std::ostream& s, std::string const& indent) const
@@ -345,6 +619,16 @@ object const& sequence::operator[](int i) const
   return *(m_impl[std::size_t(i)]);
 }
 
+std::vector<double> sequence::as_doubles() const
+{
+  std::vector<double> result;
+  result.reserve(m_impl.size());
+  for (auto const& item : m_impl) {
+    result.push_back(item->as_scalar().as_double());
+  }
+  return result;
+}
+
 void sequence::print(std::ostream& s, std::string const& indent) const
 {
   for (std::shared_ptr<parsegen::yaml::object> const& obj_ptr : *this) {
@@ -364,8 +648,9 @@ void sequence::print(std::ostream& s, std::string const& indent) const
   }
 }
 
-parser_impl::parser_impl()
-  :parsegen::parser(ask_parser_tables())
+parser_impl::parser_impl(lexing mode)
+  :parsegen::parser(ask_parser_tables(mode))
+  ,m_lexing(mode)
 {}
 
 std::any parser_impl::shift(
@@ -374,53 +659,261 @@ std::any parser_impl::shift(
   switch (token) {
     case TOK_OTHER:
     case TOK_SPACE:
+      if (m_lexing == lexing::runs) return text;
       return text[0];
+    case TOK_ANCHOR:
+    case TOK_ALIAS:
+    case TOK_DQUOTED_RUN:
+    case TOK_SQUOTED_RUN:
+      return text;
   }
   return std::any();
 }
 
+void parser_impl::begin_input()
+{
+  m_anchors.clear();
+  m_anchor_log.clear();
+}
+
+std::uint32_t parser_impl::action_mark() const
+{
+  return std::uint32_t(m_anchor_log.size());
+}
+
+/* the anchors are those made after the last time
+   they were all forgotten before the mark */
+void parser_impl::rewind_actions(std::uint32_t mark)
+{
+  resize(m_anchor_log, int(mark));
+  auto first = m_anchor_log.size();
+  while (first > 0 && m_anchor_log[first - 1].second) --first;
+  m_anchors.clear();
+  for (auto i = first; i < m_anchor_log.size(); ++i) {
+    m_anchors[m_anchor_log[i].first] = m_anchor_log[i].second;
+  }
+}
+
+std::string* parser_impl::anchor_name(std::any& value)
+{
+  return std::any_cast<std::string>(&value);
+}
+
+std::string& parser_impl::alias_name(std::any& alias)
+{
+  auto& text = std::any_cast<std::string&>(alias);
+  text.erase(0, 1);
+  return text;
+}
+
+void parser_impl::throw_unknown_alias(std::string const& name)
+{
+  throw error("The alias *" + name + " does not follow an anchor &" + name);
+}
+
+/* a later anchor with the same name replaces the earlier one */
+void parser_impl::anchor(std::any& name, std::shared_ptr<object> const& value)
+{
+  if (auto const key = anchor_name(name)) {
+    m_anchors[*key] = value;
+    m_anchor_log.emplace_back(std::move(*key), value);
+  }
+}
+
+void parser_impl::forget_anchors()
+{
+  m_anchors.clear();
+  if (!m_anchor_log.empty() && m_anchor_log.back().second) {
+    m_anchor_log.emplace_back();
+  }
+}
+
+std::shared_ptr<object> parser_impl::recall(std::any& alias)
+{
+  auto const& name = alias_name(alias);
+  auto const it = m_anchors.find(name);
+  if (it == m_anchors.end()) throw_unknown_alias(name);
+  return it->second;
+}
+
+/* the pieces of a scalar are single characters,
+   or runs of them when lexing runs */
+static void append_piece(std::string& result, std::any& piece)
+{
+  if (auto c = std::any_cast<char>(&piece)) {
+    result.push_back(*c);
+  } else {
+    result += std::any_cast<std::string&>(piece);
+  }
+}
+
+static int hex_digit_value(char c)
+{
+  if ('0' <= c && c <= '9') return c - '0';
+  if ('a' <= c && c <= 'f') return c - 'a' + 10;
+  if ('A' <= c && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+/* appends the character of the escape at the start of text, the
+   part of a double-quoted scalar after a backslash, and returns
+   how many characters of text it took: \t, \n and \r, \xHH for
+   the byte with hex value HH, which is how characters the lexer
+   does not take ("#" among them, which starts a comment) are
+   written, and otherwise the character itself */
+static std::size_t unescape(std::string_view text, std::string& out)
+{
+  auto const c = text.front();
+  if (c == 't') out.push_back('\t');
+  else if (c == 'n') out.push_back('\n');
+  else if (c == 'r') out.push_back('\r');
+  else if (c == 'x' && text.size() >= 3 &&
+      hex_digit_value(text[1]) != -1 && hex_digit_value(text[2]) != -1) {
+    out.push_back(char(hex_digit_value(text[1]) * 16 +
+          hex_digit_value(text[2])));
+    return 3;
+  } else {
+    out.push_back(c);
+  }
+  return 1;
+}
+
+/* the contents of a TOK_DQUOTED_RUN, with the escapes
+   interpreted the same way as PROD_DESCAPE does */
+static std::string unquote_double(std::string const& text)
+{
+  std::string result;
+  result.reserve(text.size() - 2);
+  auto const contents = std::string_view(text).substr(1, text.size() - 2);
+  for (std::size_t i = 0; i < contents.size();) {
+    if (contents[i] == '\\') {
+      i += 1 + unescape(contents.substr(i + 1), result);
+    } else {
+      result.push_back(contents[i++]);
+    }
+  }
+  return result;
+}
+
+/* the contents of a TOK_SQUOTED_RUN, where '' stands for ' */
+static std::string unquote_single(std::string const& text)
+{
+  std::string result;
+  result.reserve(text.size() - 2);
+  for (std::size_t i = 1; i + 1 < text.size(); ++i) {
+    result.push_back(text[i]);
+    if (text[i] == '\'') ++i;
+  }
+  return result;
+}
+
+/* The items are kept newest first in a list whose nodes are never
+   changed once made, so a checkpoint's copy of the value stack
+   shares them with the parse that carries on, and costs the same
+   however many items there are so far. */
+template <class Item>
+struct parser_impl::pending {
+  struct node {
+    Item item;
+    std::shared_ptr<node> next;
+    node(Item&& item_arg, std::shared_ptr<node>&& next_arg)
+      :item(std::move(item_arg)), next(std::move(next_arg)) {}
+    /* frees the nodes only this one holds one at a time, as
+       freeing a long list recursively could overflow the stack */
+    ~node()
+    {
+      while (next && next.use_count() == 1) next = std::move(next->next);
+    }
+  };
+  std::shared_ptr<node> newest;
+  int size = 0;
+  void push(Item&& item)
+  {
+    newest = std::make_shared<node>(std::move(item), std::move(newest));
+    ++size;
+  }
+  /* the items in document order, moved out of the nodes
+     no checkpoint shares and copied out of the others */
+  std::vector<Item> take()
+  {
+    std::vector<Item> items;
+    items.reserve(std::size_t(size));
+    bool shared = false;
+    for (auto n = &newest; *n; n = &(*n)->next) {
+      shared = shared || n->use_count() > 1;
+      if (shared) items.push_back((*n)->item);
+      else items.push_back(std::move((*n)->item));
+    }
+    std::reverse(items.begin(), items.end());
+    return items;
+  }
+};
+
+map parser_impl::finished(pending_map&& items)
+{
+  map result;
+  for (auto& item : items.take()) result.append(std::move(item));
+  result.sort_keys();
+  return result;
+}
+
+sequence parser_impl::finished(pending_sequence&& items)
+{
+  sequence result;
+  for (auto& item : items.take()) result.append(std::move(item));
+  return result;
+}
+
 std::any parser_impl::reduce(
     int production,
     std::vector<std::any>& rhs)
 {
   switch (production) {
-    case PROD_DOC:
-    case PROD_TOP_BMAP: {
-      return std::move(rhs.at(0));
+    case PROD_DOC: {
+      return finished(std::move(std::any_cast<pending_map&>(rhs.at(0))));
     }
     case PROD_DOC2: {
-      return std::move(rhs.at(1));
+      return finished(std::move(std::any_cast<pending_map&>(rhs.at(1))));
+    }
+    case PROD_TOP_BEGIN:
+    case PROD_TOP_END: {
+      /* an alias can only refer to an anchor in its own document */
+      forget_anchors();
+      return std::any();
+    }
+    case PROD_TOP_BMAP: {
+      return std::move(rhs.at(0));
     }
     case PROD_TOP_FIRST: {
-      map result;
+      pending_map result;
       if (rhs.at(0).type() == typeid(map::item)) {
         map::item& item = std::any_cast<map::item&>(
             rhs.at(0));
-        result.insert(std::move(item));
+        result.push(std::move(item));
       }
       return result;
     }
     case PROD_TOP_NEXT: {
-      map& result = std::any_cast<map&>(rhs.at(0));
+      pending_map& result = std::any_cast<pending_map&>(rhs.at(0));
       if (rhs.at(1).type() == typeid(map::item)) {
         map::item& item = std::any_cast<map::item&>(
             rhs.at(1));
-        result.insert(std::move(item));
+        result.push(std::move(item));
       }
       return std::move(result);
     }
     case PROD_BMAP_FIRST: {
-      map result;
+      pending_map result;
       map::item& item = std::any_cast<map::item&>(
           rhs.at(0));
-      result.insert(std::move(item));
+      result.push(std::move(item));
       return result;
     }
     case PROD_BMAP_NEXT: {
-      map& result = std::any_cast<map&>(rhs.at(0));
+      pending_map& result = std::any_cast<pending_map&>(rhs.at(0));
       map::item& item = std::any_cast<map::item&>(
           rhs.at(1));
-      result.insert(std::move(item));
+      result.push(std::move(item));
       return std::move(result);
     }
     case PROD_BMAP_SCALAR: {
@@ -429,6 +922,7 @@ std::any parser_impl::reduce(
         std::any_cast<scalar&>(rhs.at(4));
       std::shared_ptr<object> value(
           new scalar(std::move(scalar_value)));
+      anchor(rhs.at(3), value);
       return map::item(
           std::move(key), std::move(value));
     }
@@ -449,49 +943,51 @@ std::any parser_impl::reduce(
           std::move(key), std::move(value));
     }
     case PROD_BVALUE_BMAP: {
-      map& map_value = std::any_cast<map&>(rhs.at(1));
+      pending_map& map_value = std::any_cast<pending_map&>(rhs.at(1));
       std::shared_ptr<object> value(
-          new map(std::move(map_value)));
+          new map(finished(std::move(map_value))));
       return value;
     }
     case PROD_BVALUE_BSEQ: {
-      sequence& sequence_value =
-        std::any_cast<sequence&>(rhs.at(1));
+      pending_sequence& sequence_value =
+        std::any_cast<pending_sequence&>(rhs.at(1));
       std::shared_ptr<object> value(
-          new sequence(std::move(sequence_value)));
+          new sequence(finished(std::move(sequence_value))));
       return value;
     }
     case PROD_BMAP_FMAP: {
       scalar& key = std::any_cast<scalar&>(rhs.at(0));
-      map& map_value =
-        std::any_cast<map&>(rhs.at(4));
+      pending_map& map_value =
+        std::any_cast<pending_map&>(rhs.at(4));
       std::shared_ptr<object> value(
-          new map(std::move(map_value)));
+          new map(finished(std::move(map_value))));
+      anchor(rhs.at(3), value);
       return map::item(
           std::move(key), std::move(value));
     }
     case PROD_BMAP_FSEQ: {
       scalar& key = std::any_cast<scalar&>(rhs.at(0));
-      sequence& sequence_value =
-        std::any_cast<sequence&>(rhs.at(4));
+      pending_sequence& sequence_value =
+        std::any_cast<pending_sequence&>(rhs.at(4));
       std::shared_ptr<object> value(
-          new sequence(std::move(sequence_value)));
+          new sequence(finished(std::move(sequence_value))));
+      anchor(rhs.at(3), value);
       return map::item(
           std::move(key), std::move(value));
     }
     case PROD_BSEQ_FIRST: {
-      sequence result;
+      pending_sequence result;
       std::shared_ptr<object>& value =
         std::any_cast<std::shared_ptr<object>&>(rhs.at(0));
-      result.append(std::move(value));
+      result.push(std::move(value));
       return result;
     }
     case PROD_BSEQ_NEXT: {
-      sequence& result =
-        std::any_cast<sequence&>(rhs.at(0));
+      pending_sequence& result =
+        std::any_cast<pending_sequence&>(rhs.at(0));
       std::shared_ptr<object>& value =
         std::any_cast<std::shared_ptr<object>&>(rhs.at(1));
-      result.append(std::move(value));
+      result.push(std::move(value));
       return std::move(result);
     }
     case PROD_BSEQ_SCALAR: {
@@ -499,6 +995,7 @@ std::any parser_impl::reduce(
         std::any_cast<scalar&>(rhs.at(3));
       std::shared_ptr<object> value(
           new scalar(std::move(scalar_value)));
+      anchor(rhs.at(2), value);
       return value;
     }
     case PROD_BSEQ_BSCALAR: {
@@ -508,34 +1005,48 @@ std::any parser_impl::reduce(
           new scalar(std::move(scalar_value)));
       return value;
     }
-    case PROD_BSEQ_BMAP:
+    case PROD_BSEQ_BMAP: {
+      pending_map& map_value =
+        std::any_cast<pending_map&>(rhs.at(3));
+      std::shared_ptr<object> value(
+          new map(finished(std::move(map_value))));
+      return value;
+    }
     case PROD_BSEQ_FMAP: {
-      map& map_value =
-        std::any_cast<map&>(rhs.at(3));
+      pending_map& map_value =
+        std::any_cast<pending_map&>(rhs.at(3));
       std::shared_ptr<object> value(
-          new map(std::move(map_value)));
+          new map(finished(std::move(map_value))));
+      anchor(rhs.at(2), value);
       return value;
     }
     case PROD_BSEQ_BMAP_TRAIL: {
-      map& map_value =
-        std::any_cast<map&>(rhs.at(4));
+      pending_map& map_value =
+        std::any_cast<pending_map&>(rhs.at(4));
       std::shared_ptr<object> value(
-          new map(std::move(map_value)));
+          new map(finished(std::move(map_value))));
+      return value;
+    }
+    case PROD_BSEQ_BSEQ: {
+      pending_sequence& sequence_value =
+        std::any_cast<pending_sequence&>(rhs.at(3));
+      std::shared_ptr<object> value(
+          new sequence(finished(std::move(sequence_value))));
       return value;
     }
-    case PROD_BSEQ_BSEQ:
     case PROD_BSEQ_FSEQ: {
-      sequence& sequence_value =
-        std::any_cast<sequence&>(rhs.at(3));
+      pending_sequence& sequence_value =
+        std::any_cast<pending_sequence&>(rhs.at(3));
       std::shared_ptr<object> value(
-          new sequence(std::move(sequence_value)));
+          new sequence(finished(std::move(sequence_value))));
+      anchor(rhs.at(2), value);
       return value;
     }
     case PROD_BSEQ_BSEQ_TRAIL: {
-      sequence& sequence_value =
-        std::any_cast<sequence&>(rhs.at(4));
+      pending_sequence& sequence_value =
+        std::any_cast<pending_sequence&>(rhs.at(4));
       std::shared_ptr<object> value(
-          new sequence(std::move(sequence_value)));
+          new sequence(finished(std::move(sequence_value))));
       return value;
     }
     case PROD_FMAP:
@@ -543,19 +1054,19 @@ std::any parser_impl::reduce(
       return std::move(rhs.at(2));
     }
     case PROD_FMAP_EMPTY: {
-      return map();
+      return pending_map();
     }
     case PROD_FMAP_FIRST: {
       map::item& item = std::any_cast<map::item&>(rhs.at(0));
-      map result;
-      result.insert(std::move(item));
+      pending_map result;
+      result.push(std::move(item));
       return result;
     }
     case PROD_FMAP_NEXT: {
-      map& result = std::any_cast<map&>(rhs.at(0));
+      pending_map& result = std::any_cast<pending_map&>(rhs.at(0));
       map::item& item =
         std::any_cast<map::item&>(rhs.at(3));
-      result.insert(std::move(item));
+      result.push(std::move(item));
       return std::move(result);
     }
     case PROD_FMAP_SCALAR: {
@@ -564,43 +1075,46 @@ std::any parser_impl::reduce(
         std::any_cast<scalar&>(rhs.at(4));
       std::shared_ptr<object> value(
           new scalar(std::move(scalar_value)));
+      anchor(rhs.at(3), value);
       return map::item(
           std::move(key), std::move(value));
     }
     case PROD_FMAP_FMAP: {
       scalar& key = std::any_cast<scalar&>(rhs.at(0));
-      map& map_value =
-        std::any_cast<map&>(rhs.at(4));
+      pending_map& map_value =
+        std::any_cast<pending_map&>(rhs.at(4));
       std::shared_ptr<object> value(
-          new map(std::move(map_value)));
+          new map(finished(std::move(map_value))));
+      anchor(rhs.at(3), value);
       return map::item(
           std::move(key), std::move(value));
     }
     case PROD_FMAP_FSEQ: {
       scalar& key = std::any_cast<scalar&>(rhs.at(0));
-      sequence& sequence_value =
-        std::any_cast<sequence&>(rhs.at(4));
+      pending_sequence& sequence_value =
+        std::any_cast<pending_sequence&>(rhs.at(4));
       std::shared_ptr<object> value(
-          new sequence(std::move(sequence_value)));
+          new sequence(finished(std::move(sequence_value))));
+      anchor(rhs.at(3), value);
       return map::item(
           std::move(key), std::move(value));
     }
     case PROD_FSEQ_EMPTY: {
-      return sequence();
+      return pending_sequence();
     }
     case PROD_FSEQ_FIRST: {
       std::shared_ptr<object>& value =
         std::any_cast<std::shared_ptr<object>&>(rhs.at(0));
-      sequence result;
-      result.append(std::move(value));
+      pending_sequence result;
+      result.push(std::move(value));
       return result;
     }
     case PROD_FSEQ_NEXT: {
-      sequence& result =
-        std::any_cast<sequence&>(rhs.at(0));
+      pending_sequence& result =
+        std::any_cast<pending_sequence&>(rhs.at(0));
       std::shared_ptr<object>& value =
         std::any_cast<std::shared_ptr<object>&>(rhs.at(3));
-      result.append(std::move(value));
+      result.push(std::move(value));
       return std::move(result);
     }
     case PROD_FSEQ_SCALAR: {
@@ -608,20 +1122,23 @@ std::any parser_impl::reduce(
         std::any_cast<scalar&>(rhs.at(1));
       std::shared_ptr<object> value(
           new scalar(std::move(scalar_value)));
+      anchor(rhs.at(0), value);
       return value;
     }
     case PROD_FSEQ_FMAP: {
-      map& map_value =
-        std::any_cast<map&>(rhs.at(1));
+      pending_map& map_value =
+        std::any_cast<pending_map&>(rhs.at(1));
       std::shared_ptr<object> value(
-          new map(std::move(map_value)));
+          new map(finished(std::move(map_value))));
+      anchor(rhs.at(0), value);
       return value;
     }
     case PROD_FSEQ_FSEQ: {
-      sequence& sequence_value =
-        std::any_cast<sequence&>(rhs.at(1));
+      pending_sequence& sequence_value =
+        std::any_cast<pending_sequence&>(rhs.at(1));
       std::shared_ptr<object> value(
-          new sequence(std::move(sequence_value)));
+          new sequence(finished(std::move(sequence_value))));
+      anchor(rhs.at(0), value);
       return value;
     }
     case PROD_SCALAR_RAW: {
@@ -660,31 +1177,27 @@ std::any parser_impl::reduce(
       return scalar(scalar_string);
     }
     case PROD_SCALAR_HEAD_OTHER: {
-      char otherchar = std::any_cast<char>(rhs.at(0));
       std::string head;
-      head.push_back(otherchar);
+      append_piece(head, rhs.at(0));
       return head;
     }
     case PROD_SCALAR_HEAD_DOT: {
-      char otherchar = std::any_cast<char>(rhs.at(1));
       std::string head;
       head.push_back('.');
-      head.push_back(otherchar);
+      append_piece(head, rhs.at(1));
       return head;
     }
     case PROD_SCALAR_HEAD_DASH: {
-      char otherchar = std::any_cast<char>(rhs.at(1));
       std::string head;
       head.push_back('-');
-      head.push_back(otherchar);
+      append_piece(head, rhs.at(1));
       return head;
     }
     case PROD_SCALAR_HEAD_DOT_DOT: {
-      char otherchar = std::any_cast<char>(rhs.at(2));
       std::string head;
       head.push_back('.');
       head.push_back('.');
-      head.push_back(otherchar);
+      append_piece(head, rhs.at(2));
       return head;
     }
     case PROD_MAP_SCALAR_ESCAPED_EMPTY: {
@@ -760,9 +1273,7 @@ std::any parser_impl::reduce(
     case PROD_SCALAR_TAIL_NEXT: {
       std::string& result =
         std::any_cast<std::string&>(rhs.at(0));
-      char c =
-        std::any_cast<char>(rhs.at(1));
-      result.push_back(c);
+      append_piece(result, rhs.at(1));
       return std::move(result);
     }
     case PROD_DESCAPE_NEXT:
@@ -781,15 +1292,13 @@ std::any parser_impl::reduce(
       return '-';
     }
     case PROD_DESCAPE: {
-      char c =
-        std::any_cast<char>(rhs.at(1));
-      if (c == 't') c = '\t';
-      if (c == 'n') c = '\n';
+      /* the escape is at the start of the text up to the next one */
+      std::string escaped;
+      append_piece(escaped, rhs.at(1));
+      escaped += std::any_cast<std::string&>(rhs.at(2));
       std::string result;
-      result.push_back(c);
-      std::string& rest =
-        std::any_cast<std::string&>(rhs.at(2));
-      result += rest;
+      auto const used = unescape(escaped, result);
+      result.append(escaped, used, std::string::npos);
       return result;
     }
     case PROD_SESCAPE: {
@@ -873,10 +1382,78 @@ std::any parser_impl::reduce(
     case PROD_COMMON_OTHER: {
       return rhs.at(0);
     }
+    case PROD_TAG_ANCHOR:
+    case PROD_ANCHOR_LINE:
+    case PROD_ANCHOR_LINE_TRAIL: {
+      /* the anchor's name, without its "&" */
+      std::any_cast<std::string&>(rhs.at(0)).erase(0, 1);
+      return std::move(rhs.at(0));
+    }
+    case PROD_BMAP_ALIAS: {
+      scalar& key = std::any_cast<scalar&>(rhs.at(0));
+      return map::item(std::move(key), recall(rhs.at(3)));
+    }
+    case PROD_BMAP_ANCHORED_BVALUE: {
+      scalar& key = std::any_cast<scalar&>(rhs.at(0));
+      std::shared_ptr<object>& value =
+        std::any_cast<std::shared_ptr<object>&>(rhs.at(4));
+      anchor(rhs.at(3), value);
+      return map::item(
+          std::move(key), std::move(value));
+    }
+    case PROD_BSEQ_ALIAS: {
+      return recall(rhs.at(2));
+    }
+    case PROD_BSEQ_ANCHORED_BMAP: {
+      pending_map& map_value =
+        std::any_cast<pending_map&>(rhs.at(4));
+      std::shared_ptr<object> value(
+          new map(finished(std::move(map_value))));
+      anchor(rhs.at(2), value);
+      return value;
+    }
+    case PROD_BSEQ_ANCHORED_BSEQ: {
+      pending_sequence& sequence_value =
+        std::any_cast<pending_sequence&>(rhs.at(4));
+      std::shared_ptr<object> value(
+          new sequence(finished(std::move(sequence_value))));
+      anchor(rhs.at(2), value);
+      return value;
+    }
+    case PROD_FMAP_ALIAS: {
+      scalar& key = std::any_cast<scalar&>(rhs.at(0));
+      return map::item(std::move(key), recall(rhs.at(3)));
+    }
+    case PROD_FSEQ_ALIAS: {
+      return recall(rhs.at(0));
+    }
+    case PROD_SCALAR_TAIL_ANCHOR:
+    case PROD_SCALAR_TAIL_ALIAS:
+    case PROD_COMMON_ANCHOR:
+    case PROD_COMMON_ALIAS: {
+      return std::move(rhs.at(0));
+    }
+    case PROD_SCALAR_DQUOTED_RUN: {
+      return scalar(unquote_double(
+            std::any_cast<std::string&>(rhs.at(0))));
+    }
+    case PROD_SCALAR_SQUOTED_RUN: {
+      return scalar(unquote_single(
+            std::any_cast<std::string&>(rhs.at(0))));
+    }
+    case PROD_SCALAR_TAIL_SQUOTED_RUN:
+    case PROD_ANY_DQUOTED_RUN:
+    case PROD_ANY_SQUOTED_RUN: {
+      return std::move(rhs.at(0));
+    }
   }
   return std::any();
 }
 
+parser::parser(lexing mode)
+  :m_impl(mode)
+{}
+
 map parser::parse_stream(
     std::istream& stream,
     std::string const& stream_name_in)
@@ -900,5 +1477,106 @@ map parser::parse_file(
       m_impl.parse_file(file_path));
 }
 
+/* whether the line is a "---" or "..." document marker */
+static bool is_document_marker(std::string_view line)
+{
+  if (line.size() < 3) return false;
+  if (line.compare(0, 3, "---") != 0 && line.compare(0, 3, "...") != 0) {
+    return false;
+  }
+  auto const rest = line.find_first_not_of(" \t\r\n", 3);
+  return rest == std::string_view::npos || line[rest] == '#';
+}
+
+/* splits the text at its document markers, one pass over its lines.
+   Each document keeps the marker line that starts it, so that it
+   is parsed just as parse_string parses that part of the stream. */
+static std::vector<std::string_view> split_documents(std::string_view text)
+{
+  std::vector<std::string_view> documents;
+  std::size_t first = 0;
+  bool has_content = false;
+  auto end_document = [&](std::size_t last) {
+    if (has_content) documents.push_back(text.substr(first, last - first));
+    has_content = false;
+  };
+  for (std::size_t line_start = 0; line_start < text.size();) {
+    auto line_end = text.find('\n', line_start);
+    line_end = (line_end == std::string_view::npos) ? text.size() : line_end + 1;
+    auto const line = text.substr(line_start, line_end - line_start);
+    if (is_document_marker(line)) {
+      end_document(line_start);
+      first = line_start;
+    } else if (!has_content) {
+      auto const c = line.find_first_not_of(" \t\r\n");
+      has_content = c != std::string_view::npos &&
+        line[c] != '#' && line[c] != '%';
+    }
+    line_start = line_end;
+  }
+  end_document(text.size());
+  return documents;
+}
+
+std::vector<map> parser::parse_documents(
+    std::string_view string,
+    std::string const& string_name,
+    int nthreads)
+{
+  auto const documents = split_documents(string);
+  if (nthreads == 0) {
+    nthreads = std::max(1, int(std::thread::hardware_concurrency()));
+  }
+  std::vector<parse_result<std::any>> results;
+  reserve(results, isize(documents));
+  parsegen::parse_batch(m_impl, span<std::string_view const>(documents),
+      std::back_inserter(results), nthreads);
+  std::vector<map> out;
+  reserve(out, isize(results));
+  for (int i = 0; i < isize(results); ++i) {
+    auto& result = at(results, i);
+    if (!result) {
+      /* the failure is relative to its document; moved to where
+         the document is in the stream, it is described with the
+         line numbers of the whole stream */
+      auto failure = result.failure();
+      auto const offset = std::uint32_t(at(documents, i).data() - string.data());
+      failure.first += offset;
+      failure.last += offset;
+      m_impl.throw_failure(failure, string, string_name,
+          result.action_message());
+    }
+    out.push_back(std::any_cast<map&&>(std::move(result.value())));
+  }
+  return out;
+}
+
+std::vector<map> parser::parse_documents_file(
+    std::filesystem::path const& file_path,
+    int nthreads)
+{
+  std::ifstream stream(file_path);
+  if (!stream.is_open()) {
+    throw error("", "", "Could not open file " + file_path.string());
+  }
+  std::string contents{std::istreambuf_iterator<char>(stream),
+      std::istreambuf_iterator<char>()};
+  return parse_documents(contents, file_path.string(), nthreads);
+}
+
+void parser::set_checkpoint_interval(std::uint32_t bytes)
+{
+  m_impl.set_checkpoint_interval(bytes);
+}
+
+map parser::reparse_string(
+    std::string const& string,
+    std::uint32_t edit_first,
+    std::string const& string_name)
+{
+  return std::any_cast<map&&>(
+      m_impl.reparse_string(string, edit_first, string_name));
+}
+
 }  // end namespace yaml
 }  // end namespace parsegen
@@ -1,6 +1,8 @@
 #ifndef PARSEGEN_YAML_HPP
 #define PARSEGEN_YAML_HPP
 
+#include <unordered_map>
+
 #include "parsegen_language.hpp"
 #include "parsegen_parser_tables.hpp"
 #include "parsegen_parser.hpp"
@@ -126,10 +128,35 @@ enum {
   PROD_SPACE_STAR_EMPTY,
   PROD_SPACE_STAR_NEXT,
   PROD_SPACE_PLUS_FIRST,
-  PROD_SPACE_PLUS_NEXT
+  PROD_SPACE_PLUS_NEXT,
+  PROD_TAG_ANCHOR,
+  PROD_ANCHOR_LINE,
+  PROD_ANCHOR_LINE_TRAIL,
+  PROD_BMAP_ALIAS,
+  PROD_BMAP_ANCHORED_BVALUE,
+  PROD_BSEQ_ALIAS,
+  PROD_BSEQ_ANCHORED_BMAP,
+  PROD_BSEQ_ANCHORED_BSEQ,
+  PROD_FMAP_ALIAS,
+  PROD_FSEQ_ALIAS,
+  PROD_SCALAR_TAIL_ANCHOR,
+  PROD_SCALAR_TAIL_ALIAS,
+  PROD_COMMON_ANCHOR,
+  PROD_COMMON_ALIAS
+};
+
+enum { NPRODS = PROD_COMMON_ALIAS + 1 };
+
+/* productions only the run-lexing language has */
+enum {
+  PROD_SCALAR_DQUOTED_RUN = NPRODS,
+  PROD_SCALAR_SQUOTED_RUN,
+  PROD_SCALAR_TAIL_SQUOTED_RUN,
+  PROD_ANY_DQUOTED_RUN,
+  PROD_ANY_SQUOTED_RUN
 };
 
-enum { NPRODS = PROD_SPACE_PLUS_NEXT + 1 };
+enum { NRUN_PRODS = PROD_ANY_SQUOTED_RUN + 1 };
 
 enum {
   TOK_NEWLINE,
@@ -151,14 +178,48 @@ enum {
   TOK_COMMA,
   TOK_PERCENT,
   TOK_EXCL,
-  TOK_OTHER
+  TOK_OTHER,
+  TOK_ANCHOR,
+  TOK_ALIAS
 };
 
-enum { NTOKS = TOK_OTHER + 1 };
+enum { NTOKS = TOK_ALIAS + 1 };
+
+/* tokens only the run-lexing language has */
+enum {
+  TOK_DQUOTED_RUN = NTOKS,
+  TOK_SQUOTED_RUN
+};
 
-language build_language();
-language_ptr ask_language();
-parser_tables_ptr ask_parser_tables();
+enum { NRUN_TOKS = TOK_SQUOTED_RUN + 1 };
+
+/* How the lexer splits up scalars.
+   With characters, every character of a plain or quoted scalar
+   is its own token, shifted and appended to the scalar by its own
+   reduction. With runs, TOK_SPACE and TOK_OTHER match whole runs of
+   blanks and of plain scalar characters, and a quoted string that
+   closes on the same line is one TOK_DQUOTED_RUN or TOK_SQUOTED_RUN
+   token, so the parser does a few actions per scalar instead of a
+   few per character.
+   Both give the same yaml::map for every document the character
+   language accepts. */
+enum class lexing { characters, runs };
+
+language build_language(lexing mode = lexing::characters);
+language_ptr ask_language(lexing mode = lexing::characters);
+parser_tables_ptr ask_parser_tables(lexing mode = lexing::characters);
+
+/* the 32-bit FNV-1a hash of a key, as used to index maps */
+std::uint32_t hash_key(std::string_view key);
+
+/* the value of a scalar's text as the YAML 1.2 core schema reads it,
+   ignoring the blanks around it: decimal, 0x and 0o integers, decimal
+   floats with .inf and .nan, and true or false in lower, capitalized
+   or upper case. A double is also read from any integer form.
+   These throw std::invalid_argument if the text is not such a value. */
+double to_double(std::string_view text);
+std::int64_t to_int64(std::string_view text);
+bool to_bool(std::string_view text);
 
 class object;
 class scalar;
@@ -179,27 +240,94 @@ class object {
 
 class scalar : public object {
   std::string m_value;
+  /* the number the text was last converted to, so values that are
+     read over and over are only converted once. Because of this,
+     as_double and as_int64 must not be called from several threads
+     at once on the same scalar. */
+  enum class cached : std::uint8_t { none, real, integer };
+  mutable cached m_cached = cached::none;
+  mutable union {
+    double real;
+    std::int64_t integer;
+  } m_number = {0.0};
  public:
   scalar(std::string&& string_arg);
   scalar(std::string const& string_arg);
   bool operator<(scalar const& other) const;
   std::string const& string() const { return m_value; }
+  /* see to_double, to_int64 and to_bool */
+  double as_double() const;
+  std::int64_t as_int64() const;
+  bool as_bool() const;
   void print(std::ostream& s, std::string const& indent = "") const override;
 };
 
+/* The items are kept in a vector in document order, indexed by
+   an open-addressing hash table of their positions, so a lookup
+   hashes the key as a string_view, without building a scalar, and
+   usually compares one key. Iterating with begin() and end() visits
+   the items in key order, as with the std::map this used to be, and
+   items() has them in the order the document gave them. insert()
+   keeps the list of positions sorted by key up to date, so the const
+   functions only read the map; the parser instead appends all the
+   items of a map and sorts them once when the map is complete.
+   As with std::map::insert, an item whose key is already in the
+   map is not inserted. */
 class map : public object {
  public:
   using item = std::pair<scalar, std::shared_ptr<object>>;
-  using impl_t = std::map<scalar, std::shared_ptr<object>>;
-  using const_iterator = impl_t::const_iterator;
+  class const_iterator {
+    std::vector<item> const* m_items;
+    int const* m_position;
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = item;
+    using difference_type = std::ptrdiff_t;
+    using pointer = item const*;
+    using reference = item const&;
+    const_iterator(std::vector<item> const& items_arg, int const* position_arg)
+      :m_items(&items_arg), m_position(position_arg) {}
+    reference operator*() const { return (*m_items)[std::size_t(*m_position)]; }
+    pointer operator->() const { return &**this; }
+    const_iterator& operator++() { ++m_position; return *this; }
+    const_iterator operator++(int) { auto old = *this; ++m_position; return old; }
+    bool operator==(const_iterator const& other) const {
+      return m_position == other.m_position;
+    }
+    bool operator!=(const_iterator const& other) const {
+      return m_position != other.m_position;
+    }
+  };
  private:
-  std::map<scalar, std::shared_ptr<object>> m_impl;
+  struct slot {
+    std::uint32_t hash;
+    /* the position of the item in m_items, or -1 if the slot is empty */
+    int position;
+  };
+  std::vector<item> m_items;
+  std::vector<slot> m_slots;
+  /* the positions of the items in key order, missing
+     those appended since the last call to sort_keys */
+  std::vector<int> m_sorted;
+  /* the position of the item with this key, or -1 */
+  int find(std::string_view key, std::uint32_t hash) const;
+  void grow_slots();
+  /* adds the item as insert does, but leaves it out of key order
+     until sort_keys is called; returns false for a duplicate key */
+  bool append(item&& item_arg);
+  void sort_keys();
+  friend class parser_impl;
  public:
   void insert(item&& item_arg);
-  bool has(std::string const& key) const;
-  object const& operator[](std::string const& key) const;
+  bool has(std::string_view key) const;
+  object const& operator[](std::string_view key) const;
+  /* the value with this key, or nullptr; hash must be hash_key(key),
+     which a caller looking the same key up in many maps hashes once */
+  object const* lookup(std::string_view key, std::uint32_t hash) const;
   const_iterator begin() const;
   const_iterator end() const;
+  std::vector<item> const& items() const { return m_items; }
+  int size() const { return isize(m_items); }
   void print(std::ostream& s, std::string const& indent = "") const override;
 };
 
@@ -215,21 +343,58 @@ class sequence : public object {
   const_iterator end() const;
   int size() const;
   object const& operator[](int i) const;
+  /* the items converted with scalar::as_double, for sequences of
+     numbers such as coordinates; throws std::bad_cast if an
+     item is not a scalar */
+  std::vector<double> as_doubles() const;
   void print(std::ostream& s, std::string const& indent = "") const override;
 };
 
+/* An alias is given the very object its anchor was, so a document
+   that repeats a value by aliasing it holds it once however often
+   it is used, and changes through one alias are seen through all.
+   The values anchored in a document are forgotten at the "---" or
+   "..." that ends it, and before each input is parsed. */
 class parser_impl : public parsegen::parser {
+  lexing m_lexing;
+  std::unordered_map<std::string, std::shared_ptr<object>> m_anchors;
+  /* the anchors made since the input began, in order, with an
+     empty value where they were all forgotten, which is what
+     rewind_actions rebuilds m_anchors from */
+  std::vector<std::pair<std::string, std::shared_ptr<object>>> m_anchor_log;
+  void anchor(std::any& name, std::shared_ptr<object> const& value);
+  std::shared_ptr<object> recall(std::any& alias);
+  void forget_anchors();
+  /* the items of a map or sequence being parsed, see parsegen_yaml.cpp */
+  template <class Item>
+  struct pending;
+  using pending_map = pending<map::item>;
+  using pending_sequence = pending<std::shared_ptr<object>>;
+  /* the map or sequence of the items, the map in key order */
+  static map finished(pending_map&& items);
+  static sequence finished(pending_sequence&& items);
  public:
-  parser_impl();
+  parser_impl(lexing mode = lexing::characters);
   std::any shift(int token, std::string& text) override;
   std::any reduce(
       int production,
       std::vector<std::any>& rhs) override;
+ protected:
+  void begin_input() override;
+  std::uint32_t action_mark() const override;
+  void rewind_actions(std::uint32_t mark) override;
+  /* the name a tag? or anchor_line value anchors its value with,
+     or nullptr if it is not an anchor */
+  static std::string* anchor_name(std::any& value);
+  /* the name of the ALIAS token value, without its "*" */
+  static std::string& alias_name(std::any& alias);
+  [[noreturn]] static void throw_unknown_alias(std::string const& name);
 };
 
 class parser {
   parser_impl m_impl;
  public:
+  parser(lexing mode = lexing::characters);
   map parse_stream(
       std::istream& stream,
       std::string const& stream_name_in = "");
@@ -238,6 +403,28 @@ class parser {
       std::string const& string_name = "");
   map parse_file(
       std::filesystem::path const& file_path);
+  /* Parses a stream of several documents, each into its own map,
+     returned in stream order. A line that is just "---" or "..."
+     (and perhaps a comment) ends one document and starts the next;
+     stretches with nothing but comments and directives in them are
+     not documents. The documents are found by scanning the lines
+     before any parsing, and are then parsed concurrently by
+     parse_batch on nthreads threads, or one per hardware thread
+     if nthreads is 0. If some documents are rejected, the exception
+     is the one parse_string would throw for the first of them. */
+  std::vector<map> parse_documents(
+      std::string_view string,
+      std::string const& string_name = "",
+      int nthreads = 0);
+  std::vector<map> parse_documents_file(
+      std::filesystem::path const& file_path,
+      int nthreads = 0);
+  /* see basic_parser::set_checkpoint_interval and reparse_string */
+  void set_checkpoint_interval(std::uint32_t bytes);
+  map reparse_string(
+      std::string const& string,
+      std::uint32_t edit_first,
+      std::string const& string_name = "");
 };
 
 }  // end namespace yaml
@@ -0,0 +1,625 @@
+#include "parsegen_yaml_document.hpp"
+
+#include <algorithm>
+#include <ostream>
+#include <stdexcept>
+#include <typeinfo>
+
+namespace parsegen {
+namespace yaml {
+
+node_kind node::kind() const
+{
+  return m_document->record(m_index).kind;
+}
+
+scalar_node node::as_scalar() const
+{
+  if (!is_scalar()) throw std::bad_cast();
+  return scalar_node(*m_document, m_index);
+}
+
+map_node node::as_map() const
+{
+  if (!is_map()) throw std::bad_cast();
+  return map_node(*m_document, m_index);
+}
+
+sequence_node node::as_sequence() const
+{
+  if (!is_sequence()) throw std::bad_cast();
+  return sequence_node(*m_document, m_index);
+}
+
+void node::print(std::ostream& s, std::string const& indent) const
+{
+  switch (kind()) {
+    case node_kind::scalar:
+      s << as_scalar().string();
+      break;
+    case node_kind::map:
+      as_map().print(s, indent);
+      break;
+    case node_kind::sequence:
+      as_sequence().print(s, indent);
+      break;
+  }
+}
+
+std::string_view scalar_node::string() const
+{
+  return m_document->chars(m_document->record(m_index));
+}
+
+double scalar_node::as_double() const
+{
+  return to_double(string());
+}
+
+std::int64_t scalar_node::as_int64() const
+{
+  return to_int64(string());
+}
+
+bool scalar_node::as_bool() const
+{
+  return to_bool(string());
+}
+
+bool scalar_node::operator==(scalar_node const& other) const
+{
+  if (m_document == other.m_document && m_index == other.m_index) return true;
+  return string() == other.string();
+}
+
+bool scalar_node::operator!=(scalar_node const& other) const
+{
+  return !(*this == other);
+}
+
+/* maps are sorted by key, so lookups are binary searches
+   over the (key, value) pairs */
+static std::uint32_t const* find_entry(
+    document const& doc,
+    std::uint32_t const* first,
+    std::uint32_t const* last,
+    std::string_view key)
+{
+  auto n = (last - first) / 2;
+  while (n > 0) {
+    auto half = n / 2;
+    auto middle = first + 2 * half;
+    if (scalar_node(doc, middle[0]).string() < key) {
+      first = middle + 2;
+      n -= half + 1;
+    } else {
+      n = half;
+    }
+  }
+  if (first != last && scalar_node(doc, first[0]).string() == key) {
+    return first;
+  }
+  return nullptr;
+}
+
+bool map_node::has(std::string_view key) const
+{
+  auto& r = m_document->record(m_index);
+  auto first = m_document->m_children.data() + r.first;
+  return find_entry(*m_document, first, first + 2 * r.size, key) != nullptr;
+}
+
+node map_node::operator[](std::string_view key) const
+{
+  auto& r = m_document->record(m_index);
+  auto first = m_document->m_children.data() + r.first;
+  auto entry = find_entry(*m_document, first, first + 2 * r.size, key);
+  if (entry == nullptr) {
+    throw std::invalid_argument(
+        "yaml::map key not found: " + std::string(key));
+  }
+  return node(*m_document, entry[1]);
+}
+
+std::optional<node> map_node::lookup(std::string_view key) const
+{
+  auto& r = m_document->record(m_index);
+  auto first = m_document->m_children.data() + r.first;
+  auto entry = find_entry(*m_document, first, first + 2 * r.size, key);
+  if (entry == nullptr) return std::nullopt;
+  return node(*m_document, entry[1]);
+}
+
+map_node::const_iterator map_node::begin() const
+{
+  auto& r = m_document->record(m_index);
+  return const_iterator(*m_document, m_document->m_children.data() + r.first);
+}
+
+map_node::const_iterator map_node::end() const
+{
+  auto& r = m_document->record(m_index);
+  return const_iterator(*m_document,
+      m_document->m_children.data() + r.first + 2 * r.size);
+}
+
+int map_node::size() const
+{
+  return int(m_document->record(m_index).size);
+}
+
+void map_node::print(std::ostream& s, std::string const& indent) const
+{
+  for (auto const item : *this) {
+    s << indent << item.first.string();
+    if (item.second.is_scalar()) {
+      s << ": " << item.second.as_scalar().string() << '\n';
+    } else {
+      s << ": \n";
+      item.second.print(s, indent + "  ");
+    }
+  }
+}
+
+sequence_node::const_iterator sequence_node::begin() const
+{
+  auto& r = m_document->record(m_index);
+  return const_iterator(*m_document, m_document->m_children.data() + r.first);
+}
+
+sequence_node::const_iterator sequence_node::end() const
+{
+  auto& r = m_document->record(m_index);
+  return const_iterator(*m_document,
+      m_document->m_children.data() + r.first + r.size);
+}
+
+int sequence_node::size() const
+{
+  return int(m_document->record(m_index).size);
+}
+
+node sequence_node::operator[](int i) const
+{
+  auto& r = m_document->record(m_index);
+  return node(*m_document,
+      m_document->m_children[r.first + std::uint32_t(i)]);
+}
+
+std::vector<double> sequence_node::as_doubles() const
+{
+  auto& r = m_document->record(m_index);
+  std::vector<double> result;
+  result.reserve(r.size);
+  for (std::uint32_t i = 0; i < r.size; ++i) {
+    auto& item = m_document->record(m_document->m_children[r.first + i]);
+    if (item.kind != node_kind::scalar) throw std::bad_cast();
+    result.push_back(to_double(m_document->chars(item)));
+  }
+  return result;
+}
+
+void sequence_node::print(std::ostream& s, std::string const& indent) const
+{
+  for (auto const item : *this) {
+    s << indent << "- ";
+    if (item.is_scalar()) {
+      s << item.as_scalar().string() << '\n';
+    } else {
+      s << '\n';
+      item.print(s, indent + "  ");
+    }
+  }
+}
+
+map_node document::root() const
+{
+  return map_node(*this, m_root);
+}
+
+void document::clear()
+{
+  m_nodes.clear();
+  m_children.clear();
+  m_chars.clear();
+  m_root = 0;
+}
+
+std::uint32_t document::add_scalar(std::string_view text)
+{
+  m_nodes.push_back({node_kind::scalar,
+      std::uint32_t(m_chars.size()), std::uint32_t(text.size())});
+  m_chars.append(text);
+  return std::uint32_t(m_nodes.size() - 1);
+}
+
+std::uint32_t document::add_sequence(std::vector<std::uint32_t> const& items)
+{
+  m_nodes.push_back({node_kind::sequence,
+      std::uint32_t(m_children.size()), std::uint32_t(items.size())});
+  m_children.insert(m_children.end(), items.begin(), items.end());
+  return std::uint32_t(m_nodes.size() - 1);
+}
+
+std::uint32_t document::add_map(
+    std::vector<std::pair<std::uint32_t, std::uint32_t>>& entries)
+{
+  auto key_less = [this](auto const& a, auto const& b) {
+    return a.first != b.first &&
+      chars(record(a.first)) < chars(record(b.first));
+  };
+  auto key_equal = [this](auto const& a, auto const& b) {
+    return a.first == b.first ||
+      chars(record(a.first)) == chars(record(b.first));
+  };
+  std::stable_sort(entries.begin(), entries.end(), key_less);
+  entries.erase(std::unique(entries.begin(), entries.end(), key_equal),
+      entries.end());
+  m_nodes.push_back({node_kind::map,
+      std::uint32_t(m_children.size()), std::uint32_t(entries.size())});
+  for (auto& entry : entries) {
+    m_children.push_back(entry.first);
+    m_children.push_back(entry.second);
+  }
+  return std::uint32_t(m_nodes.size() - 1);
+}
+
+void document::set_root(std::uint32_t index)
+{
+  m_root = index;
+}
+
+namespace {
+
+/* the values on the parser stack for containers that are
+   still being parsed, naming their lists of entries */
+struct open_map { int list; };
+struct open_sequence { int list; };
+
+using map_entry = std::pair<std::uint32_t, std::uint32_t>;
+
+}  // anonymous namespace
+
+document_parser_impl::document_parser_impl(lexing mode)
+  :parser_impl(mode)
+{}
+
+void document_parser_impl::begin_document(document& out)
+{
+  m_document = &out;
+  m_document->clear();
+  m_free_entry_lists.clear();
+  for (int i = 0; i < isize(m_entry_lists); ++i) {
+    at(m_entry_lists, i).clear();
+    m_free_entry_lists.push_back(i);
+  }
+  m_free_item_lists.clear();
+  for (int i = 0; i < isize(m_item_lists); ++i) {
+    at(m_item_lists, i).clear();
+    m_free_item_lists.push_back(i);
+  }
+  m_intern_slots.assign(m_intern_slots.size(), intern_slot{0, no_node});
+  m_ninterned = 0;
+  m_anchor_nodes.clear();
+}
+
+void document_parser_impl::set_interning(
+    bool on, std::uint32_t max_value_length)
+{
+  m_interning = on;
+  m_max_interned_length = max_value_length;
+}
+
+/* keeps the table at most half full, so probe sequences stay short */
+void document_parser_impl::grow_intern_slots()
+{
+  auto old_slots = std::move(m_intern_slots);
+  m_intern_slots.assign(std::max(std::size_t(64), 2 * old_slots.size()),
+      intern_slot{0, no_node});
+  auto const mask = m_intern_slots.size() - 1;
+  for (auto const& old : old_slots) {
+    if (old.node == no_node) continue;
+    auto i = old.hash & mask;
+    while (m_intern_slots[i].node != no_node) i = (i + 1) & mask;
+    m_intern_slots[i] = old;
+  }
+}
+
+std::uint32_t document_parser_impl::add_scalar(
+    std::string_view text, bool is_key)
+{
+  if (!m_interning || (!is_key && text.size() > m_max_interned_length)) {
+    return m_document->add_scalar(text);
+  }
+  if (2 * (m_ninterned + 1) > m_intern_slots.size()) grow_intern_slots();
+  auto const hash = hash_key(text);
+  auto const mask = m_intern_slots.size() - 1;
+  auto i = hash & mask;
+  for (; m_intern_slots[i].node != no_node; i = (i + 1) & mask) {
+    auto const& s = m_intern_slots[i];
+    if (s.hash == hash && scalar_node(*m_document, s.node).string() == text) {
+      return s.node;
+    }
+  }
+  auto const node = m_document->add_scalar(text);
+  m_intern_slots[i] = intern_slot{hash, node};
+  ++m_ninterned;
+  return node;
+}
+
+int document_parser_impl::take_entry_list()
+{
+  if (m_free_entry_lists.empty()) {
+    m_entry_lists.emplace_back();
+    return isize(m_entry_lists) - 1;
+  }
+  auto list = m_free_entry_lists.back();
+  m_free_entry_lists.pop_back();
+  return list;
+}
+
+int document_parser_impl::take_item_list()
+{
+  if (m_free_item_lists.empty()) {
+    m_item_lists.emplace_back();
+    return isize(m_item_lists) - 1;
+  }
+  auto list = m_free_item_lists.back();
+  m_free_item_lists.pop_back();
+  return list;
+}
+
+std::uint32_t document_parser_impl::close_map(int list)
+{
+  auto& entries = at(m_entry_lists, list);
+  auto index = m_document->add_map(entries);
+  entries.clear();
+  m_free_entry_lists.push_back(list);
+  return index;
+}
+
+std::uint32_t document_parser_impl::close_sequence(int list)
+{
+  auto& items = at(m_item_lists, list);
+  auto index = m_document->add_sequence(items);
+  items.clear();
+  m_free_item_lists.push_back(list);
+  return index;
+}
+
+std::any document_parser_impl::reduce(
+    int production,
+    std::vector<std::any>& rhs)
+{
+  /* the productions above the scalars are mirrored from
+     parser_impl::reduce, building nodes of the document
+     instead of objects */
+  auto add_key = [&](int i) {
+    return add_scalar(
+        std::any_cast<scalar&>(rhs.at(std::size_t(i))).string(), true);
+  };
+  auto add_value = [&](int i) {
+    return add_scalar(
+        std::any_cast<scalar&>(rhs.at(std::size_t(i))).string(), false);
+  };
+  auto add_entry = [&](int list, int i) {
+    at(m_entry_lists, list).push_back(
+        std::any_cast<map_entry>(rhs.at(std::size_t(i))));
+  };
+  auto add_item = [&](int list, int i) {
+    at(m_item_lists, list).push_back(
+        std::any_cast<std::uint32_t>(rhs.at(std::size_t(i))));
+  };
+  auto map_list = [&](int i) {
+    return std::any_cast<open_map>(rhs.at(std::size_t(i))).list;
+  };
+  auto sequence_list = [&](int i) {
+    return std::any_cast<open_sequence>(rhs.at(std::size_t(i))).list;
+  };
+  /* an alias is the index of the anchored node, not a copy of it */
+  auto anchor = [&](int i, std::uint32_t node) {
+    if (auto const name = anchor_name(rhs.at(std::size_t(i)))) {
+      m_anchor_nodes[std::move(*name)] = node;
+    }
+    return node;
+  };
+  auto recall = [&](int i) {
+    auto const& name = alias_name(rhs.at(std::size_t(i)));
+    auto const it = m_anchor_nodes.find(name);
+    if (it == m_anchor_nodes.end()) throw_unknown_alias(name);
+    return it->second;
+  };
+  switch (production) {
+    case PROD_DOC:
+    case PROD_DOC2: {
+      auto root = close_map(map_list(production == PROD_DOC ? 0 : 1));
+      m_document->set_root(root);
+      return root;
+    }
+    case PROD_TOP_BEGIN:
+    case PROD_TOP_END: {
+      m_anchor_nodes.clear();
+      return std::any();
+    }
+    case PROD_TOP_BMAP: {
+      return std::move(rhs.at(0));
+    }
+    case PROD_TOP_FIRST: {
+      auto list = take_entry_list();
+      if (rhs.at(0).type() == typeid(map_entry)) add_entry(list, 0);
+      return open_map{list};
+    }
+    case PROD_TOP_NEXT: {
+      auto list = map_list(0);
+      if (rhs.at(1).type() == typeid(map_entry)) add_entry(list, 1);
+      return open_map{list};
+    }
+    case PROD_BMAP_FIRST:
+    case PROD_FMAP_FIRST: {
+      auto list = take_entry_list();
+      add_entry(list, 0);
+      return open_map{list};
+    }
+    case PROD_BMAP_NEXT: {
+      auto list = map_list(0);
+      add_entry(list, 1);
+      return open_map{list};
+    }
+    case PROD_FMAP_NEXT: {
+      auto list = map_list(0);
+      add_entry(list, 3);
+      return open_map{list};
+    }
+    case PROD_BMAP_SCALAR:
+    case PROD_FMAP_SCALAR: {
+      auto value = anchor(3, add_value(4));
+      return map_entry(add_key(0), value);
+    }
+    case PROD_BMAP_BSCALAR: {
+      auto value = add_value(3);
+      return map_entry(add_key(0), value);
+    }
+    case PROD_BMAP_BVALUE: {
+      auto value = std::any_cast<std::uint32_t>(rhs.at(4));
+      return map_entry(add_key(0), value);
+    }
+    case PROD_BMAP_ANCHORED_BVALUE: {
+      auto value = anchor(3, std::any_cast<std::uint32_t>(rhs.at(4)));
+      return map_entry(add_key(0), value);
+    }
+    case PROD_BMAP_ALIAS:
+    case PROD_FMAP_ALIAS: {
+      auto value = recall(3);
+      return map_entry(add_key(0), value);
+    }
+    case PROD_BVALUE_BMAP: {
+      return close_map(map_list(1));
+    }
+    case PROD_BVALUE_BSEQ: {
+      return close_sequence(sequence_list(1));
+    }
+    case PROD_BMAP_FMAP:
+    case PROD_FMAP_FMAP: {
+      auto value = anchor(3, close_map(map_list(4)));
+      return map_entry(add_key(0), value);
+    }
+    case PROD_BMAP_FSEQ:
+    case PROD_FMAP_FSEQ: {
+      auto value = anchor(3, close_sequence(sequence_list(4)));
+      return map_entry(add_key(0), value);
+    }
+    case PROD_BSEQ_FIRST:
+    case PROD_FSEQ_FIRST: {
+      auto list = take_item_list();
+      add_item(list, 0);
+      return open_sequence{list};
+    }
+    case PROD_BSEQ_NEXT: {
+      auto list = sequence_list(0);
+      add_item(list, 1);
+      return open_sequence{list};
+    }
+    case PROD_FSEQ_NEXT: {
+      auto list = sequence_list(0);
+      add_item(list, 3);
+      return open_sequence{list};
+    }
+    case PROD_BSEQ_SCALAR: {
+      return anchor(2, add_value(3));
+    }
+    case PROD_BSEQ_BSCALAR: {
+      return add_value(2);
+    }
+    case PROD_BSEQ_BMAP: {
+      return close_map(map_list(3));
+    }
+    case PROD_BSEQ_FMAP: {
+      return anchor(2, close_map(map_list(3)));
+    }
+    case PROD_BSEQ_BMAP_TRAIL: {
+      return close_map(map_list(4));
+    }
+    case PROD_BSEQ_ANCHORED_BMAP: {
+      return anchor(2, close_map(map_list(4)));
+    }
+    case PROD_BSEQ_BSEQ: {
+      return close_sequence(sequence_list(3));
+    }
+    case PROD_BSEQ_FSEQ: {
+      return anchor(2, close_sequence(sequence_list(3)));
+    }
+    case PROD_BSEQ_BSEQ_TRAIL: {
+      return close_sequence(sequence_list(4));
+    }
+    case PROD_BSEQ_ANCHORED_BSEQ: {
+      return anchor(2, close_sequence(sequence_list(4)));
+    }
+    case PROD_BSEQ_ALIAS: {
+      return recall(2);
+    }
+    case PROD_FMAP:
+    case PROD_FSEQ: {
+      return std::move(rhs.at(2));
+    }
+    case PROD_FMAP_EMPTY: {
+      return open_map{take_entry_list()};
+    }
+    case PROD_FSEQ_EMPTY: {
+      return open_sequence{take_item_list()};
+    }
+    case PROD_FSEQ_SCALAR: {
+      return anchor(0, add_value(1));
+    }
+    case PROD_FSEQ_FMAP: {
+      return anchor(0, close_map(map_list(1)));
+    }
+    case PROD_FSEQ_FSEQ: {
+      return anchor(0, close_sequence(sequence_list(1)));
+    }
+    case PROD_FSEQ_ALIAS: {
+      return recall(0);
+    }
+  }
+  return parser_impl::reduce(production, rhs);
+}
+
+document_parser::document_parser(lexing mode)
+  :m_impl(mode)
+{}
+
+void document_parser::set_interning(bool on, std::uint32_t max_value_length)
+{
+  m_impl.set_interning(on, max_value_length);
+}
+
+document document_parser::parse_stream(
+    std::istream& stream,
+    std::string const& stream_name_in)
+{
+  document out;
+  m_impl.begin_document(out);
+  m_impl.parse_stream(stream, stream_name_in);
+  return out;
+}
+
+document document_parser::parse_string(
+    std::string const& string,
+    std::string const& string_name)
+{
+  document out;
+  m_impl.begin_document(out);
+  m_impl.parse_string(string, string_name);
+  return out;
+}
+
+document document_parser::parse_file(
+    std::filesystem::path const& file_path)
+{
+  document out;
+  m_impl.begin_document(out);
+  m_impl.parse_file(file_path);
+  return out;
+}
+
+}  // end namespace yaml
+}  // end namespace parsegen
@@ -0,0 +1,242 @@
+#ifndef PARSEGEN_YAML_DOCUMENT_HPP
+#define PARSEGEN_YAML_DOCUMENT_HPP
+
+#include <cstdint>
+#include <iosfwd>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "parsegen_yaml.hpp"
+
+namespace parsegen {
+namespace yaml {
+
+/* A parsed YAML document that owns all of its nodes.
+   Instead of one heap object per node held by shared_ptr, the nodes
+   are records in one array, tagged with their kind, and refer to
+   their children by index into a second array; the characters of
+   all the scalars are packed into a single string.
+   All three grow only by appending while the document is parsed,
+   so building a document makes a handful of allocations rather
+   than several per node, and walking it stays within a few
+   contiguous blocks. An alias refers to the node of its anchor by
+   index like any other child, so aliased values are stored once.
+
+   It is read through node, scalar_node, map_node and sequence_node,
+   which are small handles with the same read API as object, scalar,
+   map and sequence. Handles point into the document, so they are
+   invalidated when it is moved or destroyed. */
+
+enum class node_kind : std::uint8_t { scalar, map, sequence };
+
+class document;
+class scalar_node;
+class map_node;
+class sequence_node;
+
+class node {
+ protected:
+  document const* m_document;
+  std::uint32_t m_index;
+ public:
+  node(document const& document_arg, std::uint32_t index_arg)
+    :m_document(&document_arg), m_index(index_arg) {}
+  node_kind kind() const;
+  std::uint32_t index() const { return m_index; }
+  bool is_scalar() const { return kind() == node_kind::scalar; }
+  bool is_map() const { return kind() == node_kind::map; }
+  bool is_sequence() const { return kind() == node_kind::sequence; }
+  /* these throw std::bad_cast if the node is of another kind */
+  scalar_node as_scalar() const;
+  map_node as_map() const;
+  sequence_node as_sequence() const;
+  void print(std::ostream& s, std::string const& indent = "") const;
+};
+
+class scalar_node : public node {
+ public:
+  using node::node;
+  std::string_view string() const;
+  /* see to_double, to_int64 and to_bool; unlike yaml::scalar a
+     handle has nowhere to cache the result, so each call converts */
+  double as_double() const;
+  std::int64_t as_int64() const;
+  bool as_bool() const;
+  /* interned scalars are the same node, so they are
+     matched by index before their text is compared */
+  bool operator==(scalar_node const& other) const;
+  bool operator!=(scalar_node const& other) const;
+};
+
+class map_node : public node {
+ public:
+  using item = std::pair<scalar_node, node>;
+  class const_iterator {
+    document const* m_document;
+    std::uint32_t const* m_entry;
+   public:
+    const_iterator(document const& document_arg, std::uint32_t const* entry_arg)
+      :m_document(&document_arg), m_entry(entry_arg) {}
+    item operator*() const {
+      return item(scalar_node(*m_document, m_entry[0]),
+                  node(*m_document, m_entry[1]));
+    }
+    const_iterator& operator++() { m_entry += 2; return *this; }
+    bool operator==(const_iterator const& other) const {
+      return m_entry == other.m_entry;
+    }
+    bool operator!=(const_iterator const& other) const {
+      return m_entry != other.m_entry;
+    }
+  };
+  using node::node;
+  bool has(std::string_view key) const;
+  /* throws std::invalid_argument if the key is not in the map */
+  node operator[](std::string_view key) const;
+  /* the value with this key, if the map has it */
+  std::optional<node> lookup(std::string_view key) const;
+  const_iterator begin() const;
+  const_iterator end() const;
+  int size() const;
+  void print(std::ostream& s, std::string const& indent = "") const;
+};
+
+class sequence_node : public node {
+ public:
+  class const_iterator {
+    document const* m_document;
+    std::uint32_t const* m_item;
+   public:
+    const_iterator(document const& document_arg, std::uint32_t const* item_arg)
+      :m_document(&document_arg), m_item(item_arg) {}
+    node operator*() const { return node(*m_document, *m_item); }
+    const_iterator& operator++() { ++m_item; return *this; }
+    bool operator==(const_iterator const& other) const {
+      return m_item == other.m_item;
+    }
+    bool operator!=(const_iterator const& other) const {
+      return m_item != other.m_item;
+    }
+  };
+  using node::node;
+  const_iterator begin() const;
+  const_iterator end() const;
+  int size() const;
+  node operator[](int i) const;
+  /* the items converted with scalar_node::as_double; throws
+     std::bad_cast if an item is not a scalar */
+  std::vector<double> as_doubles() const;
+  void print(std::ostream& s, std::string const& indent = "") const;
+};
+
+class document {
+ public:
+  /* the top-level map of a parsed document */
+  map_node root() const;
+  /* forgets all nodes, keeping the memory for the next document */
+  void clear();
+  /* the nodes are appended children first, so a container
+     is added after everything in it */
+  std::uint32_t add_scalar(std::string_view text);
+  std::uint32_t add_sequence(std::vector<std::uint32_t> const& items);
+  /* entries are (key scalar, value) pairs in document order; they
+     are stored sorted by key and, as in yaml::map, only the first
+     entry with a given key is kept */
+  std::uint32_t add_map(std::vector<std::pair<std::uint32_t, std::uint32_t>>& entries);
+  void set_root(std::uint32_t index);
+
+ private:
+  friend class node;
+  friend class scalar_node;
+  friend class map_node;
+  friend class sequence_node;
+  struct node_record {
+    node_kind kind;
+    /* for a scalar, its characters in m_chars; for a map, its
+       (key, value) index pairs in m_children, and for a sequence
+       its item indices in m_children */
+    std::uint32_t first;
+    std::uint32_t size;
+  };
+  std::vector<node_record> m_nodes;
+  std::vector<std::uint32_t> m_children;
+  std::string m_chars;
+  std::uint32_t m_root = 0;
+  node_record const& record(std::uint32_t index) const {
+    return m_nodes[index];
+  }
+  std::string_view chars(node_record const& r) const {
+    return std::string_view(m_chars.data() + r.first, r.size);
+  }
+};
+
+/* builds a document directly while parsing, without going through
+   the object tree that parser_impl builds */
+class document_parser_impl : public parser_impl {
+ public:
+  document_parser_impl(lexing mode = lexing::characters);
+  std::any reduce(
+      int production,
+      std::vector<std::any>& rhs) override;
+  /* starts a new document in out */
+  void begin_document(document& out);
+  void set_interning(bool on, std::uint32_t max_value_length);
+ private:
+  /* the entries of the maps and sequences not yet complete;
+     the lists are reused from container to container */
+  using entry_list = std::vector<std::pair<std::uint32_t, std::uint32_t>>;
+  using item_list = std::vector<std::uint32_t>;
+  document* m_document = nullptr;
+  std::vector<entry_list> m_entry_lists;
+  std::vector<int> m_free_entry_lists;
+  std::vector<item_list> m_item_lists;
+  std::vector<int> m_free_item_lists;
+  /* when interning, a scalar whose text was seen before in this
+     document is given the node made for it then, found through an
+     open-addressing table of (hash, node) slots */
+  struct intern_slot {
+    std::uint32_t hash;
+    std::uint32_t node;
+  };
+  static constexpr std::uint32_t no_node = ~std::uint32_t(0);
+  bool m_interning = false;
+  std::uint32_t m_max_interned_length = 0;
+  std::vector<intern_slot> m_intern_slots;
+  std::uint32_t m_ninterned = 0;
+  /* the nodes anchored so far, which aliases refer to by index */
+  std::unordered_map<std::string, std::uint32_t> m_anchor_nodes;
+  std::uint32_t add_scalar(std::string_view text, bool is_key);
+  void grow_intern_slots();
+  int take_entry_list();
+  int take_item_list();
+  std::uint32_t close_map(int list);
+  std::uint32_t close_sequence(int list);
+};
+
+class document_parser {
+  document_parser_impl m_impl;
+ public:
+  document_parser(lexing mode = lexing::characters);
+  /* With interning on, scalars with the same text are stored once
+     and share one node: all map keys, which large documents repeat
+     over and over, and values of up to max_value_length characters.
+     It is off by default. */
+  void set_interning(bool on, std::uint32_t max_value_length = 16);
+  document parse_stream(
+      std::istream& stream,
+      std::string const& stream_name_in = "");
+  document parse_string(
+      std::string const& string,
+      std::string const& string_name = "");
+  document parse_file(
+      std::filesystem::path const& file_path);
+};
+
+}  // end namespace yaml
+}  // end namespace parsegen
+
+#endif
@@ -0,0 +1,239 @@
+#include "parsegen_yaml_emitter.hpp"
+
+#include <stdexcept>
+#include <typeinfo>
+
+namespace parsegen {
+namespace yaml {
+
+/* the characters of TOK_OTHER */
+static bool is_other_char(char c)
+{
+  if (c <= ' ' || c > '~') return false;
+  switch (c) {
+    case ':': case '.': case '-': case '"': case '\'': case '\\':
+    case '|': case '[': case ']': case '{': case '}': case '>':
+    case ',': case '%': case '#': case '!':
+      return false;
+  }
+  return true;
+}
+
+/* whether the text is read back unchanged as a plain scalar:
+   a scalar_head followed by scalar_tail characters, not ending
+   in a blank, which the parser would keep but YAML would not.
+   Characters YAML gives meaning to at the start of a plain
+   scalar are quoted too. */
+static bool can_be_plain(std::string_view text)
+{
+  std::size_t i = 0;
+  while (i < 2 && i < text.size() && text[i] == '.') ++i;
+  if (i == 0 && !text.empty() && text[0] == '-') i = 1;
+  if (i == text.size() || !is_other_char(text[i])) return false;
+  switch (text[0]) {
+    case '&': case '*': case '?': case '@': case '`':
+      return false;
+  }
+  for (++i; i < text.size(); ++i) {
+    auto const c = text[i];
+    if (!(is_other_char(c) || c == ' ' || c == '\t' || c == '.' ||
+          c == '-' || c == '\'')) {
+      return false;
+    }
+  }
+  auto const last = text.back();
+  return last != ' ' && last != '\t';
+}
+
+/* "#" would start a comment and the control characters other
+   than tab and newline would not be lexed at all, so they are
+   written as \xHH escapes */
+static void append_scalar(std::string& out, std::string_view text)
+{
+  if (can_be_plain(text)) {
+    out.append(text);
+    return;
+  }
+  out.push_back('"');
+  for (char c : text) {
+    switch (c) {
+      case '"': out.append("\\\""); break;
+      case '\\': out.append("\\\\"); break;
+      case '\n': out.append("\\n"); break;
+      case '\t': out.append("\\t"); break;
+      case '\r': out.append("\\r"); break;
+      default:
+        if (c & 0x80) {
+          throw std::invalid_argument("yaml::emitter: \"" +
+              std::string(text) + "\" has non-ASCII characters, "
+              "which yaml::parser cannot read");
+        }
+        if (c == '#' || c < ' ' || c == '\x7f') {
+          char const digits[] = "0123456789abcdef";
+          out.append("\\x");
+          out.push_back(digits[(c >> 4) & 0xf]);
+          out.push_back(digits[c & 0xf]);
+        } else {
+          out.push_back(c);
+        }
+    }
+  }
+  out.push_back('"');
+}
+
+emitter::emitter(std::string& out)
+  :m_out(out)
+{}
+
+/* starts a line for the next key or item of the innermost container */
+void emitter::start_item()
+{
+  auto& container = m_open.back();
+  if (container.size++ == 0 && m_line_open) {
+    m_out.push_back('\n');
+    m_line_open = false;
+  }
+  m_out.append(std::size_t(container.indent), ' ');
+}
+
+/* starts the line of a scalar or alias: after its key, or as an item */
+void emitter::start_value()
+{
+  if (m_open.back().is_map) {
+    m_out.push_back(' ');
+  } else {
+    start_item();
+    m_out.append("- ");
+  }
+  if (!m_anchor.empty()) {
+    append_anchor();
+    m_out.push_back(' ');
+  }
+}
+
+void emitter::append_anchor()
+{
+  m_out.push_back('&');
+  m_out.append(m_anchor);
+  m_anchor.clear();
+}
+
+void emitter::start_container(bool is_map)
+{
+  if (m_open.empty()) {
+    /* the document itself cannot be anchored */
+    m_anchor.clear();
+    if (m_wrote_document) m_out.append("---\n");
+    m_open.push_back({is_map, 0, 0});
+    return;
+  }
+  if (!m_open.back().is_map) {
+    start_item();
+    m_out.push_back('-');
+    m_line_open = true;
+  }
+  if (!m_anchor.empty()) {
+    m_out.push_back(' ');
+    append_anchor();
+  }
+  m_open.push_back({is_map, m_open.back().indent + 2, 0});
+}
+
+void emitter::end_container(char const* empty)
+{
+  if (m_open.back().size == 0) {
+    if (m_line_open) m_out.push_back(' ');
+    m_out.append(empty);
+    m_out.push_back('\n');
+    m_line_open = false;
+  }
+  m_open.pop_back();
+  if (m_open.empty()) m_wrote_document = true;
+}
+
+void emitter::on_map_start()
+{
+  start_container(true);
+}
+
+void emitter::on_map_end()
+{
+  end_container("{}");
+}
+
+void emitter::on_sequence_start()
+{
+  start_container(false);
+}
+
+void emitter::on_sequence_end()
+{
+  end_container("[]");
+}
+
+void emitter::on_key(std::string_view key)
+{
+  start_item();
+  append_scalar(m_out, key);
+  m_out.push_back(':');
+  m_line_open = true;
+}
+
+void emitter::on_scalar(std::string_view value)
+{
+  start_value();
+  append_scalar(m_out, value);
+  m_out.push_back('\n');
+  m_line_open = false;
+}
+
+void emitter::on_anchor(std::string_view name)
+{
+  m_anchor.assign(name);
+}
+
+void emitter::on_alias(std::string_view name)
+{
+  start_value();
+  m_out.push_back('*');
+  m_out.append(name);
+  m_out.push_back('\n');
+  m_line_open = false;
+}
+
+/* the parser only makes objects of exactly these types, so they
+   are told apart by typeid, which is much cheaper than the failing
+   dynamic_casts of object::is_map and is_sequence */
+void emitter::emit_object(object const& value)
+{
+  auto const& type = typeid(value);
+  if (type == typeid(scalar)) {
+    on_scalar(static_cast<scalar const&>(value).string());
+  } else if (type == typeid(map)) {
+    on_map_start();
+    for (auto& item : static_cast<map const&>(value).items()) {
+      on_key(item.first.string());
+      emit_object(*item.second);
+    }
+    on_map_end();
+  } else {
+    on_sequence_start();
+    for (auto& item : value.as_sequence()) emit_object(*item);
+    on_sequence_end();
+  }
+}
+
+void emitter::emit(map const& document)
+{
+  emit_object(document);
+}
+
+std::string emit(map const& document)
+{
+  std::string out;
+  emitter(out).emit(document);
+  return out;
+}
+
+}  // end namespace yaml
+}  // end namespace parsegen
@@ -0,0 +1,69 @@
+#ifndef PARSEGEN_YAML_EMITTER_HPP
+#define PARSEGEN_YAML_EMITTER_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "parsegen_yaml.hpp"
+#include "parsegen_yaml_events.hpp"
+
+namespace parsegen {
+namespace yaml {
+
+/* Writes YAML in block style, appending to a string the caller owns,
+   so that one buffer reserved ahead of time can take many documents.
+   Indentation is appended as a count of spaces rather than built up
+   as strings, and each scalar is written plain if yaml::parser would
+   read it back unchanged, and double-quoted with \", \\, \n, \t, \r
+   and \xHH escapes otherwise. Like the parser, it only takes ASCII:
+   a scalar with other characters in it is a std::invalid_argument.
+   Empty maps and sequences are written {} and [].
+
+   It is an event_handler, so an event_parser can drive it directly,
+   and the anchors and aliases it reports are written back as they
+   were; emit() sends it the events of a whole map, in which an object
+   that several items share is written out again for each of them.
+   Each top-level map after the first starts with a "---" line. */
+class emitter final : public event_handler {
+ public:
+  explicit emitter(std::string& out);
+  void on_map_start() override;
+  void on_map_end() override;
+  void on_sequence_start() override;
+  void on_sequence_end() override;
+  void on_key(std::string_view key) override;
+  void on_scalar(std::string_view value) override;
+  void on_anchor(std::string_view name) override;
+  void on_alias(std::string_view name) override;
+  /* writes the items in document order */
+  void emit(map const& document);
+ private:
+  struct open_container {
+    bool is_map;
+    /* the column the lines of its contents start at */
+    int indent;
+    int size;
+  };
+  std::string& m_out;
+  std::vector<open_container> m_open;
+  /* a "key:" or "-" line waits for its value */
+  bool m_line_open = false;
+  bool m_wrote_document = false;
+  /* the anchor of the next value, written just before it */
+  std::string m_anchor;
+  void start_item();
+  void start_value();
+  void append_anchor();
+  void start_container(bool is_map);
+  void end_container(char const* empty);
+  void emit_object(object const& value);
+};
+
+/* the map as emitter writes it */
+std::string emit(map const& document);
+
+}  // end namespace yaml
+}  // end namespace parsegen
+
+#endif
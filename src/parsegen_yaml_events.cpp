@@ -0,0 +1,181 @@
+#include "parsegen_yaml_events.hpp"
+
+#include <stdexcept>
+
+namespace parsegen {
+namespace yaml {
+
+event_parser_impl::event_parser_impl(lexing mode)
+  :parser_impl(mode)
+  ,m_bseq_items_symbol(at(grammar->productions, PROD_BSEQ_FIRST).lhs)
+{}
+
+void event_parser_impl::begin_events(event_handler& handler)
+{
+  m_handler = &handler;
+  m_open.clear();
+}
+
+void event_parser_impl::start_containers(int limit)
+{
+  auto frame = m_open.empty() ? 0 : m_open.back().frame + 1;
+  for (; frame < limit; ++frame) {
+    auto const symbol = at(frames, frame).symbol;
+    bool is_map;
+    if (frame == 0) {
+      /* the document itself is a map */
+      is_map = true;
+    } else if (symbol == TOK_LCURLY) {
+      is_map = true;
+    } else if (symbol == TOK_LSQUARE) {
+      is_map = false;
+    } else if (symbol == TOK_INDENT) {
+      /* a block sequence starts with "-", or has been
+         reduced to bseq_items by the time it ends */
+      auto const next = at(frames, frame + 1).symbol;
+      is_map = !(next == TOK_DASH || next == m_bseq_items_symbol);
+    } else {
+      continue;
+    }
+    m_open.push_back({frame, is_map});
+    if (is_map) m_handler->on_map_start();
+    else m_handler->on_sequence_start();
+  }
+}
+
+void event_parser_impl::end_container(int frame)
+{
+  start_containers(frame + 1);
+  if (m_open.empty() || m_open.back().frame != frame) {
+    throw std::logic_error(
+        "bug in yaml::event_parser: container ended that was not started");
+  }
+  auto const is_map = m_open.back().is_map;
+  m_open.pop_back();
+  if (is_map) m_handler->on_map_end();
+  else m_handler->on_sequence_end();
+}
+
+std::any event_parser_impl::reduce(
+    int production,
+    std::vector<std::any>& rhs)
+{
+  auto const first_frame = isize(frames) - isize(rhs);
+  switch (production) {
+    case PROD_SCALAR_RAW:
+    case PROD_SCALAR_QUOTED: {
+      /* a scalar followed by ":" is a key */
+      auto value = parser_impl::reduce(production, rhs);
+      start_containers(first_frame);
+      auto const& text = std::any_cast<scalar&>(value).string();
+      if (lexer_token == TOK_COLON) m_handler->on_key(text);
+      else m_handler->on_scalar(text);
+      return std::any();
+    }
+    case PROD_MAP_SCALAR_RAW:
+    case PROD_MAP_SCALAR_QUOTED:
+    case PROD_BSCALAR: {
+      auto value = parser_impl::reduce(production, rhs);
+      start_containers(first_frame);
+      m_handler->on_scalar(std::any_cast<scalar&>(value).string());
+      return std::any();
+    }
+    case PROD_BVALUE_EMPTY: {
+      start_containers(first_frame);
+      m_handler->on_scalar(std::string_view());
+      return std::any();
+    }
+    case PROD_DOC:
+    case PROD_DOC2: {
+      end_container(0);
+      return std::any();
+    }
+    case PROD_BVALUE_BMAP:
+    case PROD_BVALUE_BSEQ:
+    case PROD_FMAP:
+    case PROD_FMAP_EMPTY:
+    case PROD_FSEQ:
+    case PROD_FSEQ_EMPTY: {
+      end_container(first_frame);
+      return std::any();
+    }
+    case PROD_BSEQ_BMAP:
+    case PROD_BSEQ_BSEQ: {
+      end_container(first_frame + 2);
+      return std::any();
+    }
+    case PROD_BSEQ_BMAP_TRAIL:
+    case PROD_BSEQ_BSEQ_TRAIL:
+    case PROD_BSEQ_ANCHORED_BMAP:
+    case PROD_BSEQ_ANCHORED_BSEQ: {
+      end_container(first_frame + 3);
+      return std::any();
+    }
+    case PROD_TAG_ANCHOR:
+    case PROD_ANCHOR_LINE:
+    case PROD_ANCHOR_LINE_TRAIL: {
+      start_containers(first_frame);
+      auto const& text = std::any_cast<std::string&>(rhs.at(0));
+      m_handler->on_anchor(std::string_view(text).substr(1));
+      return std::any();
+    }
+    case PROD_BMAP_ALIAS:
+    case PROD_FMAP_ALIAS: {
+      start_containers(first_frame);
+      m_handler->on_alias(alias_name(rhs.at(3)));
+      return std::any();
+    }
+    case PROD_BSEQ_ALIAS: {
+      start_containers(first_frame);
+      m_handler->on_alias(alias_name(rhs.at(2)));
+      return std::any();
+    }
+    case PROD_FSEQ_ALIAS: {
+      start_containers(first_frame);
+      m_handler->on_alias(alias_name(rhs.at(0)));
+      return std::any();
+    }
+    case PROD_BMAP_ANCHORED_BVALUE: {
+      return std::any();
+    }
+  }
+  /* the other productions that make up containers have
+     nothing to build, since their contents were reported */
+  if (PROD_DOC <= production && production <= PROD_FSEQ_FSEQ) {
+    return std::any();
+  }
+  return parser_impl::reduce(production, rhs);
+}
+
+event_parser::event_parser(lexing mode)
+  :m_impl(mode)
+{}
+
+void event_parser::parse_stream(
+    std::istream& stream,
+    event_handler& handler,
+    std::string const& stream_name_in)
+{
+  m_impl.begin_events(handler);
+  m_impl.parse_stream(stream, stream_name_in);
+}
+
+void event_parser::parse_string(
+    std::string const& string,
+    event_handler& handler,
+    std::string const& string_name)
+{
+  m_impl.begin_events(handler);
+  m_impl.parse_string(string, string_name);
+}
+
+void event_parser::parse_file(
+    std::filesystem::path const& file_path,
+    event_handler& handler)
+{
+  m_impl.begin_events(handler);
+  m_impl.parse_file(file_path);
+}
+
+}  // end namespace yaml
+}  // end namespace parsegen
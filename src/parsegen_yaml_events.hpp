@@ -0,0 +1,89 @@
+#ifndef PARSEGEN_YAML_EVENTS_HPP
+#define PARSEGEN_YAML_EVENTS_HPP
+
+#include <filesystem>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "parsegen_yaml.hpp"
+
+namespace parsegen {
+namespace yaml {
+
+/* Receives a YAML document as a stream of events in document order,
+   the way a SAX handler receives XML:
+
+     a: 1          on_map_start     (the top-level map)
+     b: [x, y]     on_key a, on_scalar 1
+                   on_key b, on_sequence_start,
+                     on_scalar x, on_scalar y, on_sequence_end
+                   on_map_end
+
+   An anchored value is preceded by on_anchor with the anchor's name,
+   and an alias is reported by on_alias instead of being replayed.
+   The views passed to the handler are only valid during the call.
+   A handler may throw to stop parsing early. */
+class event_handler {
+ public:
+  virtual ~event_handler() = default;
+  virtual void on_map_start() {}
+  virtual void on_map_end() {}
+  virtual void on_sequence_start() {}
+  virtual void on_sequence_end() {}
+  virtual void on_key(std::string_view) {}
+  virtual void on_scalar(std::string_view) {}
+  virtual void on_anchor(std::string_view) {}
+  virtual void on_alias(std::string_view) {}
+};
+
+/* Emits events from reduce() instead of building objects, so the
+   memory used does not grow with the size of the document.
+   The LR parser only learns that a container has started when it
+   reduces something inside it, so before each event the frames of
+   the parser stack are checked for the "{", "[" and INDENT that
+   open containers whose start has not been reported yet. */
+class event_parser_impl : public parser_impl {
+ public:
+  event_parser_impl(lexing mode = lexing::characters);
+  std::any reduce(
+      int production,
+      std::vector<std::any>& rhs) override;
+  /* starts a new document, sending its events to handler */
+  void begin_events(event_handler& handler);
+ private:
+  struct open_container {
+    /* the parser stack frame that opened it */
+    int frame;
+    bool is_map;
+  };
+  event_handler* m_handler = nullptr;
+  std::vector<open_container> m_open;
+  int m_bseq_items_symbol;
+  /* reports the start of the containers opened below frame limit */
+  void start_containers(int limit);
+  void end_container(int frame);
+};
+
+class event_parser {
+  event_parser_impl m_impl;
+ public:
+  event_parser(lexing mode = lexing::characters);
+  void parse_stream(
+      std::istream& stream,
+      event_handler& handler,
+      std::string const& stream_name_in = "");
+  void parse_string(
+      std::string const& string,
+      event_handler& handler,
+      std::string const& string_name = "");
+  void parse_file(
+      std::filesystem::path const& file_path,
+      event_handler& handler);
+};
+
+}  // end namespace yaml
+}  // end namespace parsegen
+
+#endif
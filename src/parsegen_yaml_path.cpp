@@ -0,0 +1,189 @@
+#include "parsegen_yaml_path.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
+#include <typeinfo>
+
+namespace parsegen {
+namespace yaml {
+
+[[noreturn]] static void throw_bad_path(
+    std::string_view text, std::size_t position, char const* problem)
+{
+  throw std::invalid_argument("yaml::path \"" + std::string(text) +
+      "\": " + problem + " at character " + std::to_string(position + 1));
+}
+
+path::path(std::string_view text)
+{
+  std::size_t i = 0;
+  auto add_key = [&](std::size_t first) {
+    m_steps.push_back({step_kind::key,
+        hash_key(std::string_view(m_keys).substr(first)),
+        std::int32_t(first), std::uint32_t(m_keys.size() - first)});
+  };
+  /* a key segment, up to the next "." or "[" */
+  auto read_key = [&]() {
+    auto const first = m_keys.size();
+    if (i < text.size() && text[i] == '"') {
+      for (++i;; ++i) {
+        if (i == text.size()) throw_bad_path(text, i, "unclosed quote");
+        if (text[i] == '"') break;
+        if (text[i] == '\\' && i + 1 < text.size()) ++i;
+        m_keys.push_back(text[i]);
+      }
+      ++i;
+      add_key(first);
+      return;
+    }
+    auto const last = std::min(text.find_first_of(".[", i), text.size());
+    if (last == i) throw_bad_path(text, i, "empty key");
+    auto const name = text.substr(i, last - i);
+    i = last;
+    if (name == "*") {
+      m_steps.push_back({step_kind::every_value, 0, 0, 0});
+      return;
+    }
+    m_keys.append(name);
+    add_key(first);
+  };
+  auto read_index = [&]() {
+    auto const close = text.find(']', i);
+    if (close == std::string_view::npos) {
+      throw_bad_path(text, i, "unclosed [");
+    }
+    auto const index = text.substr(i + 1, close - i - 1);
+    if (index == "*") {
+      m_steps.push_back({step_kind::every_item, 0, 0, 0});
+    } else {
+      auto const end = index.data() + index.size();
+      std::int32_t value = 0;
+      auto const result = std::from_chars(index.data(), end, value);
+      if (index.empty() || result.ec != std::errc() || result.ptr != end) {
+        throw_bad_path(text, i + 1, "bad index");
+      }
+      m_steps.push_back({step_kind::index, 0, value, 0});
+    }
+    i = close + 1;
+  };
+  if (text.empty()) return;
+  if (text[0] != '[') read_key();
+  while (i < text.size()) {
+    if (text[i] == '[') {
+      read_index();
+    } else if (text[i] == '.') {
+      ++i;
+      read_key();
+    } else {
+      throw_bad_path(text, i, "expected \".\" or \"[\"");
+    }
+  }
+}
+
+/* Visit is called with each value reached, and returns
+   false to stop the walk, which then returns false too.
+   As in emitter, objects are told apart by typeid. */
+template <class Visit>
+bool path::walk(object const& value, std::size_t i, Visit& visit) const
+{
+  if (i == m_steps.size()) return visit(value);
+  auto const& s = m_steps[i];
+  auto const& type = typeid(value);
+  if (s.kind == step_kind::key || s.kind == step_kind::every_value) {
+    if (type != typeid(map)) return true;
+    auto const& m = static_cast<map const&>(value);
+    if (s.kind == step_kind::key) {
+      auto const next = m.lookup(key(s), s.hash);
+      return next == nullptr || walk(*next, i + 1, visit);
+    }
+    for (auto const& item : m) {
+      if (!walk(*item.second, i + 1, visit)) return false;
+    }
+    return true;
+  }
+  if (type != typeid(sequence)) return true;
+  auto const& items = static_cast<sequence const&>(value);
+  if (s.kind == step_kind::index) {
+    auto const index = s.first < 0 ? s.first + items.size() : s.first;
+    if (index < 0 || index >= items.size()) return true;
+    return walk(items[index], i + 1, visit);
+  }
+  for (auto const& item : items) {
+    if (!walk(*item, i + 1, visit)) return false;
+  }
+  return true;
+}
+
+template <class Visit>
+bool path::walk(node value, std::size_t i, Visit& visit) const
+{
+  if (i == m_steps.size()) return visit(value);
+  auto const& s = m_steps[i];
+  if (s.kind == step_kind::key || s.kind == step_kind::every_value) {
+    if (!value.is_map()) return true;
+    auto const m = value.as_map();
+    if (s.kind == step_kind::key) {
+      auto const next = m.lookup(key(s));
+      return !next || walk(*next, i + 1, visit);
+    }
+    for (auto const item : m) {
+      if (!walk(item.second, i + 1, visit)) return false;
+    }
+    return true;
+  }
+  if (!value.is_sequence()) return true;
+  auto const items = value.as_sequence();
+  if (s.kind == step_kind::index) {
+    auto const index = s.first < 0 ? s.first + items.size() : s.first;
+    if (index < 0 || index >= items.size()) return true;
+    return walk(items[index], i + 1, visit);
+  }
+  for (auto const item : items) {
+    if (!walk(item, i + 1, visit)) return false;
+  }
+  return true;
+}
+
+object const* path::find(map const& root) const
+{
+  object const* result = nullptr;
+  auto visit = [&](object const& value) {
+    result = &value;
+    return false;
+  };
+  walk(root, 0, visit);
+  return result;
+}
+
+std::optional<node> path::find(map_node const& root) const
+{
+  std::optional<node> result;
+  auto visit = [&](node value) {
+    result = value;
+    return false;
+  };
+  walk(root, 0, visit);
+  return result;
+}
+
+void path::find_all(map const& root, std::vector<object const*>& out) const
+{
+  auto visit = [&](object const& value) {
+    out.push_back(&value);
+    return true;
+  };
+  walk(root, 0, visit);
+}
+
+void path::find_all(map_node const& root, std::vector<node>& out) const
+{
+  auto visit = [&](node value) {
+    out.push_back(value);
+    return true;
+  };
+  walk(root, 0, visit);
+}
+
+}  // end namespace yaml
+}  // end namespace parsegen
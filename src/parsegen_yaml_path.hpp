@@ -0,0 +1,67 @@
+#ifndef PARSEGEN_YAML_PATH_HPP
+#define PARSEGEN_YAML_PATH_HPP
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "parsegen_yaml.hpp"
+#include "parsegen_yaml_document.hpp"
+
+namespace parsegen {
+namespace yaml {
+
+/* A query for the values at a path below the top-level map:
+
+     servers[0].name      the name of the first server
+     servers[-1].name     ... of the last one
+     servers[*].name      ... of every server
+     build.*.flags        the flags of every entry of build
+     "a.b".c              keys with ".", "[" or a lone "*" are quoted,
+                          with \" and \\ as escapes
+
+   The text is compiled once into a list of steps, each key already
+   hashed, so evaluating the path against many maps or documents
+   builds no strings and hashes nothing. A step that does not apply,
+   such as a key missing from the map or an index on a scalar, just
+   reaches no values. Wildcards visit maps in key order, the order
+   they are iterated in. */
+class path {
+ public:
+  /* throws std::invalid_argument if the text is not a path */
+  explicit path(std::string_view text);
+  /* the first value the path reaches, or nullptr */
+  object const* find(map const& root) const;
+  std::optional<node> find(map_node const& root) const;
+  /* appends every value the path reaches to out, so one vector
+     can collect the values of a batch of documents */
+  void find_all(map const& root, std::vector<object const*>& out) const;
+  void find_all(map_node const& root, std::vector<node>& out) const;
+ private:
+  enum class step_kind : std::uint8_t { key, index, every_value, every_item };
+  struct step {
+    step_kind kind;
+    /* for a key step, hash_key of the key */
+    std::uint32_t hash;
+    /* for a key step, where the key is in m_keys;
+       for an index step, the index, from the end if negative */
+    std::int32_t first;
+    std::uint32_t size;
+  };
+  std::vector<step> m_steps;
+  std::string m_keys;
+  std::string_view key(step const& s) const {
+    return std::string_view(m_keys).substr(s.first, s.size);
+  }
+  template <class Visit>
+  bool walk(object const& value, std::size_t i, Visit& visit) const;
+  template <class Visit>
+  bool walk(node value, std::size_t i, Visit& visit) const;
+};
+
+}  // end namespace yaml
+}  // end namespace parsegen
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef PARSEGEN_TEST_HPP
+#define PARSEGEN_TEST_HPP
+
+#include <cstdlib>
+#include <iostream>
+
+/* The tests are plain programs: a failed check prints where it
+   is and the program goes on, returning failure from main. */
+
+namespace parsegen {
+namespace test {
+
+inline int& failures()
+{
+  static int count = 0;
+  return count;
+}
+
+inline void check(bool condition, char const* text, char const* file, int line)
+{
+  if (condition) return;
+  std::cerr << file << ":" << line << ": check failed: " << text << '\n';
+  ++failures();
+}
+
+/* whether calling f throws an Exception */
+template <class Exception, class F>
+bool throws(F&& f)
+{
+  try {
+    f();
+  } catch (Exception const&) {
+    return true;
+  }
+  return false;
+}
+
+inline int result()
+{
+  return failures() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+}  // end namespace test
+}  // end namespace parsegen
+
+#define PARSEGEN_CHECK(condition) \
+  ::parsegen::test::check(bool(condition), #condition, __FILE__, __LINE__)
+
+#endif
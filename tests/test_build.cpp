@@ -0,0 +1,81 @@
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "parsegen_build_result.hpp"
+#include "parsegen_language.hpp"
+#include "parsegen_test.hpp"
+
+using parsegen::build_failure;
+using parsegen::test::throws;
+
+static parsegen::language make_language(std::string const& ignored)
+{
+  parsegen::language lang;
+  lang.tokens = {{"word", "[a-z]+"}, {"space", "[ ]+"}};
+  lang.ignored_tokens = {ignored};
+  lang.productions = {{"sentence", {"words"}},
+    {"words", {"word"}}, {"words", {"words", "word"}}};
+  return lang;
+}
+
+/* an ignored token that is not a token of the language is
+   reported like the other problems with the language */
+static void test_ignored_token()
+{
+  PARSEGEN_CHECK(parsegen::try_build_parser_tables(make_language("space")));
+  for (auto name : {"tab", "words"}) {
+    auto const lang = make_language(name);
+    auto const result = parsegen::try_build_parser_tables(lang);
+    PARSEGEN_CHECK(!result);
+    PARSEGEN_CHECK(result.failure() &&
+        result.failure()->get_kind() == build_failure::kind::invalid_language);
+    std::string message;
+    try {
+      parsegen::build_parser_tables(lang);
+    } catch (parsegen::build_error const& e) {
+      message = e.what();
+      PARSEGEN_CHECK(message == e.failure()->describe());
+    }
+    PARSEGEN_CHECK(message.find(name) != std::string::npos);
+  }
+}
+
+/* a grammar with conflicts is reported with them by
+   try_build_parser_tables, and build_parser_tables throws
+   the same failure, whose text is made once for all readers */
+static void test_conflicts()
+{
+  parsegen::language lang;
+  lang.tokens = {{"x", "x"}};
+  lang.productions = {{"s", {"e"}}, {"e", {"e", "e"}}, {"e", {"x"}}};
+  auto const result = parsegen::try_build_parser_tables(lang);
+  PARSEGEN_CHECK(!result && !result.tables());
+  PARSEGEN_CHECK(result.failure() &&
+      result.failure()->get_kind() != build_failure::kind::invalid_language);
+  PARSEGEN_CHECK(throws<parsegen::build_error>(
+      [&] { result.tables_or_throw(); }));
+  try {
+    parsegen::build_parser_tables(lang);
+    PARSEGEN_CHECK(false);
+  } catch (parsegen::build_error const& e) {
+    PARSEGEN_CHECK(e.failure()->get_kind() == result.failure()->get_kind());
+    int const nthreads = 4;
+    std::vector<char const*> texts(nthreads);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < nthreads; ++i) {
+      threads.emplace_back([&, i] { texts[std::size_t(i)] = e.what(); });
+    }
+    for (auto& thread : threads) thread.join();
+    for (auto text : texts) PARSEGEN_CHECK(text == texts[0]);
+    PARSEGEN_CHECK(texts[0] == e.failure()->describe());
+    PARSEGEN_CHECK(e.failure()->describe() == result.failure()->describe());
+  }
+}
+
+int main()
+{
+  test_ignored_token();
+  test_conflicts();
+  return parsegen::test::result();
+}
@@ -0,0 +1,38 @@
+#include <type_traits>
+
+#include "parsegen_build_profile.hpp"
+#include "parsegen_test.hpp"
+
+static_assert(std::is_nothrow_destructible<parsegen::phase_timer>::value,
+    "phase_timer must not throw from its destructor");
+
+/* a timer that is stopped and then destroyed records its phase once */
+static void test_stop_then_destroy()
+{
+  parsegen::build_profile profile;
+  {
+    parsegen::phase_timer first(&profile, "first");
+    first.stop();
+    first.stop();
+    parsegen::phase_timer second(&profile, "second");
+  }
+  PARSEGEN_CHECK(profile.phases.size() == 2);
+  PARSEGEN_CHECK(profile.phases[0].name == "first");
+  PARSEGEN_CHECK(profile.phases[1].name == "second");
+  PARSEGEN_CHECK(profile.phases[0].seconds >= 0.0);
+  PARSEGEN_CHECK(profile.phases[1].seconds >= 0.0);
+}
+
+/* without a profile the timer records nothing */
+static void test_no_profile()
+{
+  parsegen::phase_timer timer(nullptr, "unused");
+  timer.stop();
+}
+
+int main()
+{
+  test_stop_then_destroy();
+  test_no_profile();
+  return parsegen::test::result();
+}
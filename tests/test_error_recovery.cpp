@@ -0,0 +1,107 @@
+#include <string>
+
+#include "parsegen_callback_parser.hpp"
+#include "parsegen_language.hpp"
+#include "parsegen_test.hpp"
+
+using parsegen::parse_failure;
+
+enum { TOK_NUM, TOK_SEMI, TOK_PLUS, TOK_SPACE };
+
+enum {
+  PROD_PROGRAM,
+  PROD_FIRST,
+  PROD_NEXT,
+  PROD_STATEMENT,
+  PROD_ERROR,
+  PROD_NUM,
+  PROD_SUM
+};
+
+/* statements ending in ";", where a statement that can't be
+   parsed is skipped up to its ";"; the value is the number of
+   statements that could be parsed */
+static parsegen::callback_parser<int> make_parser()
+{
+  parsegen::language lang;
+  lang.tokens = {{"NUM", "[0-9]+"}, {"SEMI", ";"}, {"PLUS", "\\+"},
+    {"SPACE", "[ ]+"}};
+  lang.ignored_tokens = {"SPACE"};
+  lang.productions = {
+    {"program", {"statements"}},
+    {"statements", {"statement"}},
+    {"statements", {"statements", "statement"}},
+    {"statement", {"expr", "SEMI"}},
+    {"statement", {"error", "SEMI"}},
+    {"expr", {"NUM"}},
+    {"expr", {"expr", "PLUS", "NUM"}}};
+  parsegen::callback_parser<int> parser(parsegen::build_parser_tables(lang));
+  parser.pass_through(PROD_PROGRAM, 0);
+  parser.pass_through(PROD_FIRST, 0);
+  parser.on_reduce(PROD_NEXT, [](parsegen::span<int> rhs) {
+    return rhs[0] + rhs[1];
+  });
+  parser.on_reduce(PROD_STATEMENT, [](parsegen::span<int>) { return 1; });
+  return parser;
+}
+
+static std::string text_of(parse_failure const& failure, std::string const& text)
+{
+  return text.substr(failure.first, failure.last - failure.first);
+}
+
+/* each error is recovered from at the statement it is in,
+   and the parse carries on to find the next one */
+static void test_several_errors()
+{
+  auto parser = make_parser();
+  std::string const text = "1+2; + ; 3; 4 4; 5;";
+  PARSEGEN_CHECK(parser.parse_string(text) == 3);
+  auto const& diagnostics = parser.get_diagnostics();
+  PARSEGEN_CHECK(diagnostics.size() == 2);
+  if (diagnostics.size() != 2) return;
+  PARSEGEN_CHECK(
+      diagnostics[0].kind == parse_failure::kind::unacceptable_token);
+  PARSEGEN_CHECK(text_of(diagnostics[0], text) == "+");
+  PARSEGEN_CHECK(text_of(diagnostics[1], text) == "4");
+  PARSEGEN_CHECK(diagnostics[1].first == 14);
+  /* the next parse starts with no diagnostics */
+  PARSEGEN_CHECK(parser.parse_string("1;") == 1);
+  PARSEGEN_CHECK(parser.get_diagnostics().empty());
+}
+
+/* an error found before three tokens have been shifted since the
+   last one is taken to be part of it and is not reported */
+static void test_suppression_window()
+{
+  auto parser = make_parser();
+  PARSEGEN_CHECK(parser.parse_string("+ ; + ; 1;") == 1);
+  PARSEGEN_CHECK(parser.get_diagnostics().size() == 1);
+  PARSEGEN_CHECK(parser.parse_string("+ ; 1 1 ; 2;") == 1);
+  PARSEGEN_CHECK(parser.get_diagnostics().size() == 1);
+  PARSEGEN_CHECK(parser.parse_string("+ ; 1 ; + ; 2;") == 2);
+  PARSEGEN_CHECK(parser.get_diagnostics().size() == 2);
+}
+
+/* the input ending while tokens are being discarded
+   after "error" is an error that can't be recovered from */
+static void test_end_while_discarding()
+{
+  auto parser = make_parser();
+  std::string const text = "1; + 2";
+  auto const result = parser.try_parse_string(text);
+  PARSEGEN_CHECK(!result);
+  PARSEGEN_CHECK(
+      result.failure().kind == parse_failure::kind::unacceptable_token);
+  PARSEGEN_CHECK(parser.get_diagnostics().size() == 1);
+  PARSEGEN_CHECK(parsegen::test::throws<parsegen::error>(
+      [&] { parser.parse_string(text); }));
+}
+
+int main()
+{
+  test_several_errors();
+  test_suppression_window();
+  test_end_while_discarding();
+  return parsegen::test::result();
+}
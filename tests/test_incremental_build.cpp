@@ -0,0 +1,36 @@
+#include <string>
+
+#include "parsegen_incremental_build.hpp"
+#include "parsegen_test.hpp"
+
+using parsegen::test::throws;
+
+static parsegen::language make_language()
+{
+  parsegen::language lang;
+  lang.tokens = {{"A", "a"}, {"B", "b"}};
+  lang.productions = {{"top", {"s"}}, {"s", {"A"}}, {"s", {"s", "A"}}};
+  return lang;
+}
+
+/* a token whose DFA is already cached is still checked,
+   so the builder rejects what build_parser_tables rejects */
+static void test_cached_token_is_checked()
+{
+  parsegen::incremental_builder builder;
+  PARSEGEN_CHECK(builder.build(make_language()) != nullptr);
+  auto unnamed = make_language();
+  unnamed.tokens[1].name = "";
+  PARSEGEN_CHECK(throws<parsegen::build_error>(
+      [&] { parsegen::build_parser_tables_uncached(unnamed); }));
+  PARSEGEN_CHECK(throws<parsegen::build_error>(
+      [&] { builder.build(unnamed); }));
+  PARSEGEN_CHECK(builder.build(make_language()) != nullptr);
+  PARSEGEN_CHECK(builder.get_ncached_token_dfas() == 2);
+}
+
+int main()
+{
+  test_cached_token_is_checked();
+  return parsegen::test::result();
+}
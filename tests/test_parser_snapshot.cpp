@@ -0,0 +1,115 @@
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "parsegen_callback_parser.hpp"
+#include "parsegen_language.hpp"
+#include "parsegen_parser_snapshot.hpp"
+#include "parsegen_test.hpp"
+
+using parsegen::parse_failure;
+
+enum { PROD_PROGRAM, PROD_FIRST, PROD_NEXT, PROD_STATEMENT };
+
+/* statements ending in ";", with syntax errors recovered from at
+   the next ";", so that snapshots carry diagnostics; the value is
+   the number of statements that could be parsed */
+static parsegen::callback_parser<int> make_parser()
+{
+  parsegen::language lang;
+  lang.tokens = {{"NUM", "[0-9]+"}, {"SEMI", ";"}, {"PLUS", "\\+"},
+    {"SPACE", "[ \n]+"}};
+  lang.ignored_tokens = {"SPACE"};
+  lang.productions = {
+    {"program", {"statements"}},
+    {"statements", {"statement"}},
+    {"statements", {"statements", "statement"}},
+    {"statement", {"expr", "SEMI"}},
+    {"statement", {"error", "SEMI"}},
+    {"expr", {"NUM"}},
+    {"expr", {"expr", "PLUS", "NUM"}}};
+  parsegen::callback_parser<int> parser(parsegen::build_parser_tables(lang));
+  parser.pass_through(PROD_PROGRAM, 0);
+  parser.pass_through(PROD_FIRST, 0);
+  parser.on_reduce(PROD_NEXT, [](parsegen::span<int> rhs) {
+    return rhs[0] + rhs[1];
+  });
+  parser.on_reduce(PROD_STATEMENT, [](parsegen::span<int>) { return 1; });
+  return parser;
+}
+
+static void write_value(std::ostream& stream, int const& value)
+{
+  stream.write(reinterpret_cast<char const*>(&value), sizeof(value));
+}
+
+static int read_value(std::istream& stream)
+{
+  int value = 0;
+  stream.read(reinterpret_cast<char*>(&value), sizeof(value));
+  return value;
+}
+
+static bool same(std::vector<parse_failure> const& a,
+    std::vector<parse_failure> const& b)
+{
+  if (a.size() != b.size()) return false;
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    if (a[i].kind != b[i].kind || a[i].token != b[i].token ||
+        a[i].state != b[i].state || a[i].first != b[i].first ||
+        a[i].last != b[i].last) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* a parse resumed in a fresh parser from any of the snapshots
+   saved along the way ends as the uninterrupted parse did */
+static void test_resume_from_every_snapshot(
+    std::string const& text, std::vector<std::string>& saved)
+{
+  auto parser = make_parser();
+  parser.set_snapshot_handler(16,
+      [&](parsegen::parser_snapshot<int> const& snapshot) {
+        std::ostringstream stream;
+        parsegen::write_snapshot(stream, snapshot, write_value);
+        saved.push_back(stream.str());
+      });
+  auto const value = parser.parse_string(text);
+  auto const diagnostics = parser.get_diagnostics();
+  PARSEGEN_CHECK(value == 8);
+  PARSEGEN_CHECK(diagnostics.size() == 8);
+  PARSEGEN_CHECK(saved.size() >= text.size() / 16 - 1);
+  for (auto const& bytes : saved) {
+    std::istringstream snapshot_stream(bytes);
+    auto resumed = make_parser();
+    resumed.restore(
+        parsegen::read_snapshot<int>(snapshot_stream, read_value));
+    std::istringstream text_stream(text);
+    PARSEGEN_CHECK(resumed.resume_stream(text_stream) == value);
+    PARSEGEN_CHECK(same(resumed.get_diagnostics(), diagnostics));
+  }
+}
+
+/* a snapshot cut short anywhere is rejected rather than restored */
+static void test_truncated_snapshot(std::string const& bytes)
+{
+  for (std::size_t size = 0; size < bytes.size(); ++size) {
+    std::istringstream stream(bytes.substr(0, size));
+    PARSEGEN_CHECK(parsegen::test::throws<parsegen::error>(
+        [&] { parsegen::read_snapshot<int>(stream, read_value); }));
+  }
+}
+
+int main()
+{
+  std::string text;
+  for (int i = 0; i < 4; ++i) text += "1+2; + ;\n3; 4 4;\n";
+  std::vector<std::string> saved;
+  test_resume_from_every_snapshot(text, saved);
+  if (!saved.empty()) test_truncated_snapshot(saved.back());
+  return parsegen::test::result();
+}
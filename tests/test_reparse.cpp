@@ -0,0 +1,67 @@
+#include <string>
+
+#include "parsegen_callback_parser.hpp"
+#include "parsegen_language.hpp"
+#include "parsegen_test.hpp"
+
+enum { TOK_NUM, TOK_SEMI };
+
+enum { PROD_PROGRAM, PROD_FIRST, PROD_NEXT, PROD_STATEMENT };
+
+/* numbers ending in ";", whose value is their sum;
+   nshifts counts the numbers given to the shift action */
+static parsegen::callback_parser<int> make_parser(int& nshifts)
+{
+  parsegen::language lang;
+  lang.tokens = {{"NUM", "[0-9]+"}, {"SEMI", ";"}};
+  lang.productions = {
+    {"program", {"statements"}},
+    {"statements", {"statement"}},
+    {"statements", {"statements", "statement"}},
+    {"statement", {"NUM", "SEMI"}}};
+  parsegen::callback_parser<int> parser(parsegen::build_parser_tables(lang));
+  parser.on_shift(TOK_NUM, [&nshifts](std::string& text) {
+    ++nshifts;
+    return std::stoi(text);
+  });
+  parser.pass_through(PROD_PROGRAM, 0);
+  parser.pass_through(PROD_FIRST, 0);
+  parser.on_reduce(PROD_NEXT, [](parsegen::span<int> rhs) {
+    return rhs[0] + rhs[1];
+  });
+  parser.pass_through(PROD_STATEMENT, 0);
+  return parser;
+}
+
+/* a reparse starts from the values at the checkpoint before the
+   edit, so the actions are not run again for the text before it */
+static void test_prefix_not_rerun()
+{
+  int nshifts = 0;
+  auto parser = make_parser(nshifts);
+  parser.set_checkpoint_interval(64);
+  std::string text;
+  int sum = 0;
+  for (int i = 0; i < 1000; ++i) {
+    text += std::to_string(i % 10) + ";";
+    sum += i % 10;
+  }
+  PARSEGEN_CHECK(parser.parse_string(text) == sum);
+  PARSEGEN_CHECK(nshifts == 1000);
+  nshifts = 0;
+  auto const edit_first = std::uint32_t(text.size() - 2);
+  text.replace(edit_first, 1, "17");
+  PARSEGEN_CHECK(parser.reparse_string(text, edit_first) == sum - 9 + 17);
+  PARSEGEN_CHECK(0 < nshifts && nshifts <= 64);
+  /* an edit before the first checkpoint is a full parse */
+  nshifts = 0;
+  text.replace(0, 1, "5");
+  PARSEGEN_CHECK(parser.reparse_string(text, 0) == sum - 9 + 17 + 5);
+  PARSEGEN_CHECK(nshifts == 1000);
+}
+
+int main()
+{
+  test_prefix_not_rerun();
+  return parsegen::test::result();
+}
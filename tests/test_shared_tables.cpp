@@ -0,0 +1,34 @@
+#include <thread>
+#include <vector>
+
+#include "parsegen_math_lang.hpp"
+#include "parsegen_yaml.hpp"
+#include "parsegen_test.hpp"
+
+/* threads that first ask for the shared tables at the same time
+   are all given the one set of tables */
+static void test_first_use_from_threads()
+{
+  int const nthreads = 4;
+  std::vector<parsegen::parser_tables_ptr> yaml_tables(nthreads);
+  std::vector<std::size_t> nvariables(nthreads);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < nthreads; ++i) {
+    threads.emplace_back([&, i] {
+      yaml_tables[std::size_t(i)] = parsegen::yaml::ask_parser_tables();
+      nvariables[std::size_t(i)] =
+        parsegen::math_lang::get_variables_used("x + y * f(z)").size();
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  for (int i = 0; i < nthreads; ++i) {
+    PARSEGEN_CHECK(yaml_tables[std::size_t(i)] == yaml_tables[0]);
+    PARSEGEN_CHECK(nvariables[std::size_t(i)] == 3);
+  }
+}
+
+int main()
+{
+  test_first_use_from_threads();
+  return parsegen::test::result();
+}
@@ -0,0 +1,70 @@
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <string>
+
+#include "parsegen_language.hpp"
+#include "parsegen_parser.hpp"
+#include "parsegen_table_cache.hpp"
+#include "parsegen_test.hpp"
+
+static parsegen::language make_language()
+{
+  parsegen::language lang;
+  lang.tokens = {{"word", "[a-z]+"}, {"space", "[ ]+"}};
+  lang.ignored_tokens = {"space"};
+  lang.productions = {{"sentence", {"words"}},
+    {"words", {"word"}}, {"words", {"words", "word"}}};
+  return lang;
+}
+
+static bool parses(parsegen::parser_tables_ptr const& tables)
+{
+  try {
+    parsegen::parser parser(tables);
+    parser.parse_string("some words here", "s");
+    return true;
+  } catch (std::exception const&) {
+    return false;
+  }
+}
+
+/* tables read back from a cache file work, and a file with any one
+   number in it replaced by a huge one is either a miss or still
+   holds working tables, never ones that index out of bounds */
+static void test_corrupt_files_miss()
+{
+  auto const lang = make_language();
+  auto const tables = parsegen::build_parser_tables(lang);
+  std::stringstream stream;
+  parsegen::write_parser_tables(stream, lang, *tables);
+  auto const file = stream.str();
+  {
+    std::stringstream in(file);
+    PARSEGEN_CHECK(parses(parsegen::read_parser_tables(in, lang)));
+  }
+  {
+    std::stringstream in(file.substr(0, file.size() / 2));
+    PARSEGEN_CHECK(!parsegen::read_parser_tables(in, lang));
+  }
+  int nmisses = 0;
+  for (std::size_t i = 8; i + 4 <= file.size(); i += 4) {
+    auto corrupt = file;
+    std::int32_t const huge = 0x7ffffff0;
+    std::memcpy(&corrupt[i], &huge, sizeof(huge));
+    std::stringstream in(corrupt);
+    auto const read = parsegen::read_parser_tables(in, lang);
+    if (!read) {
+      ++nmisses;
+      continue;
+    }
+    PARSEGEN_CHECK(parses(read));
+  }
+  PARSEGEN_CHECK(nmisses > 0);
+}
+
+int main()
+{
+  test_corrupt_files_miss();
+  return parsegen::test::result();
+}
@@ -0,0 +1,66 @@
+#include <string>
+
+#include "parsegen_error.hpp"
+#include "parsegen_yaml.hpp"
+#include "parsegen_yaml_document.hpp"
+#include "parsegen_test.hpp"
+
+using parsegen::test::throws;
+
+/* parse_documents takes exactly the streams parse_string takes,
+   and rejects the others with the same exception */
+static void test_same_as_parse_string(parsegen::yaml::parser& parser)
+{
+  std::string const blank_line_first = "---\n  \na: 1\n";
+  auto const whole = parser.parse_string(blank_line_first, "s");
+  PARSEGEN_CHECK(whole.has("a"));
+  auto const documents = parser.parse_documents(blank_line_first, "s", 1);
+  PARSEGEN_CHECK(documents.size() == 1);
+  PARSEGEN_CHECK(documents.size() == 1 && documents[0].has("a"));
+  /* one rejected by the grammar, one by a semantic action */
+  for (std::string const rejected : {
+        "a: 1\n---\nb: [1, 2\nc: 3\n",
+        "a: 1\n---\nb: *nope\n"}) {
+    std::string whole_message, documents_message;
+    try {
+      parser.parse_string(rejected, "s");
+    } catch (parsegen::error const& e) {
+      whole_message = e.what();
+    }
+    try {
+      parser.parse_documents(rejected, "s", 2);
+    } catch (parsegen::error const& e) {
+      documents_message = e.what();
+    }
+    PARSEGEN_CHECK(whole_message.find("line 3 of s") != std::string::npos);
+    PARSEGEN_CHECK(documents_message == whole_message);
+  }
+}
+
+/* an alias cannot refer to an anchor of an earlier document,
+   whichever entry point parsed them */
+static void test_anchors_per_document(parsegen::yaml::parser& parser)
+{
+  std::string const own = "a: &x 1\nb: *x\n---\nc: &x 2\nd: *x\n";
+  PARSEGEN_CHECK(parser.parse_documents(own, "s", 1).size() == 2);
+  std::string const crossing = "a: &x 1\n---\nb: *x\n";
+  PARSEGEN_CHECK(throws<parsegen::error>(
+        [&] { parser.parse_string(crossing, "s"); }));
+  PARSEGEN_CHECK(throws<parsegen::error>(
+        [&] { parser.parse_documents(crossing, "s", 1); }));
+  parsegen::yaml::document_parser document_parser;
+  PARSEGEN_CHECK(throws<parsegen::error>(
+        [&] { document_parser.parse_string(crossing, "s"); }));
+  /* nor to one of an earlier input */
+  parser.parse_string("a: &y 1\n", "s");
+  PARSEGEN_CHECK(throws<parsegen::error>(
+        [&] { parser.parse_string("b: *y\n", "s"); }));
+}
+
+int main()
+{
+  parsegen::yaml::parser parser;
+  test_same_as_parse_string(parser);
+  test_anchors_per_document(parser);
+  return parsegen::test::result();
+}
@@ -0,0 +1,57 @@
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "parsegen_error.hpp"
+#include "parsegen_yaml.hpp"
+#include "parsegen_yaml_emitter.hpp"
+#include "parsegen_test.hpp"
+
+using parsegen::test::throws;
+using namespace parsegen::yaml;
+
+/* scalars the emitter has to quote or escape come back unchanged
+   from both lexing modes of the parser, as keys and as values */
+static void test_round_trip()
+{
+  std::vector<std::string> const texts = {
+    "#x", "x #y", "x#y", "x # y", "a\rb", "a\r\nb", "tab\there",
+    std::string("nul\0byte", 8), "bell\a", "del\x7f", "esc\x1b[0m",
+    "\"quoted\" \\ back", "- dash", "trailing ", "", "plain words"};
+  map m;
+  for (std::size_t i = 0; i < texts.size(); ++i) {
+    m.insert(map::item(scalar(texts[i]), std::make_shared<scalar>(
+            texts[texts.size() - 1 - i])));
+  }
+  auto const text = emit(m);
+  for (auto mode : {lexing::characters, lexing::runs}) {
+    parser p(mode);
+    try {
+      auto const back = p.parse_string(text, "emitted");
+      PARSEGEN_CHECK(back.size() == m.size());
+      for (std::size_t i = 0; i < texts.size(); ++i) {
+        PARSEGEN_CHECK(back.has(texts[i]) &&
+            back[texts[i]].as_scalar().string() ==
+            texts[texts.size() - 1 - i]);
+      }
+    } catch (parsegen::error const& e) {
+      PARSEGEN_CHECK(!"the emitted text parses");
+    }
+  }
+}
+
+/* the parser only reads ASCII, so the emitter does not write more */
+static void test_non_ascii()
+{
+  map m;
+  m.insert(map::item(scalar("k"), std::make_shared<scalar>("caf\xc3\xa9")));
+  PARSEGEN_CHECK(throws<std::invalid_argument>([&] { emit(m); }));
+}
+
+int main()
+{
+  test_round_trip();
+  test_non_ascii();
+  return parsegen::test::result();
+}
@@ -0,0 +1,66 @@
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "parsegen_yaml.hpp"
+#include "parsegen_test.hpp"
+
+using parsegen::yaml::map;
+using parsegen::yaml::scalar;
+
+static void insert(map& m, std::string const& key)
+{
+  m.insert(map::item(scalar(key), std::make_shared<scalar>(key)));
+}
+
+static std::string keys(map const& m)
+{
+  std::string out;
+  for (auto const& item : m) out += item.first.string() + " ";
+  return out;
+}
+
+/* iteration is in key order, also after more items are inserted
+   into a map that has been iterated, and duplicates are ignored */
+static void test_key_order()
+{
+  map m;
+  for (auto key : {"d", "b", "e"}) insert(m, key);
+  PARSEGEN_CHECK(keys(m) == "b d e ");
+  for (auto key : {"a", "c", "b", "f"}) insert(m, key);
+  PARSEGEN_CHECK(m.size() == 6);
+  PARSEGEN_CHECK(keys(m) == "a b c d e f ");
+  PARSEGEN_CHECK(m.items().front().first.string() == "d");
+  PARSEGEN_CHECK(m.has("c") && !m.has("g"));
+}
+
+/* the maps the parser returns are already in key order, so
+   threads can iterate the same const map at once */
+static void test_parsed_maps_iterate_concurrently()
+{
+  parsegen::yaml::parser parser;
+  map const m = parser.parse_string(
+      "d: 1\nb: {z: 1, y: 2}\nc:\n  - {q: 1, p: 2}\na: 0\n");
+  int const nthreads = 4;
+  std::vector<std::string> seen(nthreads);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < nthreads; ++i) {
+    threads.emplace_back([&, i] {
+      std::string& out = seen[std::size_t(i)];
+      out = keys(m) + "/ " + keys(m["b"].as_map()) + "/ " +
+        keys((*m["c"].as_sequence().begin())->as_map());
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  for (auto const& out : seen) {
+    PARSEGEN_CHECK(out == "a b c d / y z / p q ");
+  }
+}
+
+int main()
+{
+  test_key_order();
+  test_parsed_maps_iterate_concurrently();
+  return parsegen::test::result();
+}
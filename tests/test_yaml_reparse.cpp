@@ -0,0 +1,44 @@
+#include <sstream>
+#include <string>
+
+#include "parsegen_yaml.hpp"
+#include "parsegen_test.hpp"
+
+static std::string printed(parsegen::yaml::map const& m)
+{
+  std::stringstream stream;
+  m.print(stream);
+  return stream.str();
+}
+
+/* reparsing after an edit gives what parsing the edited text does,
+   including values anchored before the checkpoint it resumes from */
+static void test_reparse_after_edit()
+{
+  std::string text = "base: &b [1, 2]\n";
+  for (int i = 0; i < 2000; ++i) {
+    text += "key" + std::to_string(i) + ": " + std::to_string(i) + "\n";
+  }
+  parsegen::yaml::parser parser;
+  parser.set_checkpoint_interval(1024);
+  parser.parse_string(text, "text");
+  auto const edit_first = std::uint32_t(text.size());
+  text += "last: *b\n";
+  auto const reparsed = parser.reparse_string(text, edit_first, "text");
+  parsegen::yaml::parser fresh;
+  auto const parsed = fresh.parse_string(text, "text");
+  PARSEGEN_CHECK(reparsed.size() == 2002);
+  PARSEGEN_CHECK(printed(reparsed) == printed(parsed));
+  PARSEGEN_CHECK(&reparsed["last"] == &reparsed["base"]);
+  /* and again, from a checkpoint of the reparse */
+  text.replace(text.size() - 9, 4, "lest");
+  auto const again = parser.reparse_string(text, edit_first, "text");
+  PARSEGEN_CHECK(again.has("lest") && !again.has("last"));
+  PARSEGEN_CHECK(printed(again) == printed(fresh.parse_string(text, "text")));
+}
+
+int main()
+{
+  test_reparse_after_edit();
+  return parsegen::test::result();
+}